@@ -3,19 +3,31 @@
 #include "rng.hpp"
 
 #include <algorithm> // std::fill
+#include <iomanip>
 #include <iostream>
 
+#if defined(SLIDERS_PEXT)
+#include <immintrin.h>
+#endif
+
 Bitboard knightAttacks[64];
 Bitboard kingAttacks[64];
 Bitboard pawnAttacks[2][64];
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+Bitboard slidingAttacksTable[rookPackedTableSize + bishopPackedTableSize];
+SlidingAttacks rookSlidingAttacks[64];
+SlidingAttacks bishopSlidingAttacks[64];
+#else
 Bitboard rookAttacks[64][4096];
 Bitboard bishopAttacks[64][512];
+#endif
+
+Bitboard betweenBitboards[64][64];
+Bitboard lineBitboards[64][64];
 
 Bitboard rookMasks[64];
 Bitboard bishopMasks[64];
 
-Bitboard rookMagics[64];
-Bitboard bishopMagics[64];
 std::uint8_t rookMagicShifts[64];
 std::uint8_t bishopMagicShifts[64];
 
@@ -58,14 +70,12 @@ void initPawnAttacks() {
 void initRookAttacks() {
     initRookMasks();
     initRookShifts();
-    initRookMagics();
     initSlidingAttacks(SlidingPiece::Rook);
 }
 
 void initBishopAttacks() {
     initBishopMasks();
     initBishopShifts();
-    initBishopMagics();
     initSlidingAttacks(SlidingPiece::Bishop);
 }
 
@@ -75,6 +85,26 @@ void initAttacks() {
     initPawnAttacks();
     initRookAttacks();
     initBishopAttacks();
+    initLineBitboards();
+}
+
+void initLineBitboards() {
+    for (std::uint8_t sq1 = 0; sq1 < 64; sq1++) {
+        Square square1 { sq1 };
+        for (std::uint8_t sq2 = 0; sq2 < 64; sq2++) {
+            Square square2 { sq2 };
+            Bitboard squares = Bitboard(square1) | Bitboard(square2);
+
+            if (getRookAttacksOTF(square1, 0ULL) & square2) {
+                lineBitboards[sq1][sq2] = (getRookAttacksOTF(square1, 0ULL) & getRookAttacksOTF(square2, 0ULL)) | squares;
+                betweenBitboards[sq1][sq2] = getRookAttacksOTF(square1, square2) & getRookAttacksOTF(square2, square1);
+            }
+            else if (getBishopAttacksOTF(square1, 0ULL) & square2) {
+                lineBitboards[sq1][sq2] = (getBishopAttacksOTF(square1, 0ULL) & getBishopAttacksOTF(square2, 0ULL)) | squares;
+                betweenBitboards[sq1][sq2] = getBishopAttacksOTF(square1, square2) & getBishopAttacksOTF(square2, square1);
+            }
+        }
+    }
 }
 
 void initRookMasks() {
@@ -145,20 +175,6 @@ Bitboard getBishopAttacksOTF(Square square, Bitboard occupied) {
     return attacks;
 }
 
-void initRookMagics() {
-    for (std::uint8_t sq = 0; sq < 64; sq++) {
-        Square square { sq };
-        rookMagics[square.index()] = findMagic(square, SlidingPiece::Rook);
-    }
-}
-
-void initBishopMagics() {
-    for (std::uint8_t sq = 0; sq < 64; sq++) {
-        Square square { sq };
-        bishopMagics[square.index()] = findMagic(square, SlidingPiece::Bishop);
-    }
-}
-
 Bitboard findMagic(Square square, SlidingPiece piece) {
     Bitboard mask = piece == SlidingPiece::Rook ? rookMasks[square.index()] : bishopMasks[square.index()];
 
@@ -214,6 +230,48 @@ Bitboard findMagic(Square square, SlidingPiece piece) {
     return 0ULL;
 }
 
+void printMagics() {
+    for (SlidingPiece piece : {SlidingPiece::Rook, SlidingPiece::Bishop}) {
+        std::cout << "constexpr Bitboard " << (piece == SlidingPiece::Rook ? "rook" : "bishop") << "Magics[64] = {\n";
+        for (std::uint8_t sq = 0; sq < 64; sq++) {
+            const std::uint64_t magic = static_cast<std::uint64_t>(findMagic(Square {sq}, piece));
+            std::cout << (sq % 4 == 0 ? "    " : " ") << "0x" << std::hex << std::setw(16) << std::setfill('0') << magic << std::dec << "ULL," << (sq % 4 == 3 ? "\n" : "");
+        }
+        std::cout << "};\n" << std::endl;
+    }
+}
+
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+static inline std::uint32_t getSlidingIndex(const SlidingAttacks& entry, Bitboard occupied) {
+#if defined(SLIDERS_PEXT)
+    return static_cast<std::uint32_t>(_pext_u64(static_cast<std::uint64_t>(occupied), static_cast<std::uint64_t>(entry.mask)));
+#else
+    return static_cast<std::uint32_t>(static_cast<std::uint64_t>((occupied & entry.mask) * entry.magic) >> entry.shift);
+#endif
+}
+
+void initSlidingAttacks(SlidingPiece piece) {
+    // rook entries come first in the packed table, each square owns 2^(mask bits) consecutive entries
+    Bitboard* attacksTable = (piece == SlidingPiece::Rook) ? slidingAttacksTable : slidingAttacksTable + rookPackedTableSize;
+
+    for (std::uint8_t sq = 0; sq < 64; sq++) {
+        Square square { sq };
+        SlidingAttacks& entry = (piece == SlidingPiece::Rook) ? rookSlidingAttacks[sq] : bishopSlidingAttacks[sq];
+        entry.mask = piece == SlidingPiece::Rook ? rookMasks[square.index()] : bishopMasks[square.index()];
+        entry.magic = piece == SlidingPiece::Rook ? rookMagics[square.index()] : bishopMagics[square.index()];
+        entry.shift = piece == SlidingPiece::Rook ? rookMagicShifts[square.index()] : bishopMagicShifts[square.index()];
+        entry.attacks = attacksTable;
+
+        Bitboard variation = 0ULL;
+        do {
+            attacksTable[getSlidingIndex(entry, variation)] = piece == SlidingPiece::Rook ? getRookAttacksOTF(square, variation) : getBishopAttacksOTF(square, variation);
+            variation = (variation - entry.mask) & entry.mask; // Carry-Rippler trick
+        } while (variation);
+
+        attacksTable += 1ULL << entry.mask.count();
+    }
+}
+#else
 void initSlidingAttacks(SlidingPiece piece) {
     for (std::uint8_t sq = 0; sq < 64; sq++) {
         Square square { sq };
@@ -235,6 +293,7 @@ void initSlidingAttacks(SlidingPiece piece) {
         } while (variation);
     }
 }
+#endif
 
 Bitboard getKnightAttacks(Square square) {
     return knightAttacks[square.index()];
@@ -249,21 +308,47 @@ Bitboard getPawnAttacks(Square square, Color color) {
 }
 
 Bitboard getRookAttacks(Square square, Bitboard occupied) {
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+    const SlidingAttacks& entry = rookSlidingAttacks[square.index()];
+    return entry.attacks[getSlidingIndex(entry, occupied)];
+#else
     Bitboard mask = rookMasks[square.index()];
     Bitboard magic = rookMagics[square.index()];
     std::uint8_t shift = rookMagicShifts[square.index()];
     std::uint16_t magicIndex = static_cast<std::uint16_t>(((occupied & mask) * magic) >> shift);
     return rookAttacks[square.index()][magicIndex];
+#endif
 }
 
 Bitboard getBishopAttacks(Square square, Bitboard occupied) {
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+    const SlidingAttacks& entry = bishopSlidingAttacks[square.index()];
+    return entry.attacks[getSlidingIndex(entry, occupied)];
+#else
     Bitboard mask = bishopMasks[square.index()];
     Bitboard magic = bishopMagics[square.index()];
     std::uint8_t shift = bishopMagicShifts[square.index()];
     std::uint16_t magicIndex = static_cast<std::uint16_t>(((occupied & mask) * magic) >> shift);
     return bishopAttacks[square.index()][magicIndex];
+#endif
 }
 
 Bitboard getQueenAttacks(Square square, Bitboard occupied) {
     return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
 }
+
+std::uint64_t getSlidingAttacksTableSize() {
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+    return sizeof(slidingAttacksTable);
+#else
+    return sizeof(rookAttacks) + sizeof(bishopAttacks);
+#endif
+}
+
+Bitboard getBetween(Square square1, Square square2) {
+    return betweenBitboards[square1.index()][square2.index()];
+}
+
+Bitboard getLine(Square square1, Square square2) {
+    return lineBitboards[square1.index()][square2.index()];
+}
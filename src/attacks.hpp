@@ -2,27 +2,60 @@
 
 #include "bitboard.hpp"
 #include "color.hpp"
+#include "magics.hpp"
 #include "piece.hpp"
 #include "square.hpp"
 
 #include <cstdint>
 
+// sliding attacks backend, selected at compile time:
+//  - default: plain magic bitboards, fixed 64x4096 rook and 64x512 bishop tables (2.25 MiB)
+//  - SLIDERS_FANCY: variable size magics sharing one packed table (841 KiB)
+//  - SLIDERS_PEXT: same packed table indexed with the BMI2 pext instruction
+#if defined(SLIDERS_PEXT)
+#if !defined(__BMI2__)
+#error "SLIDERS_PEXT needs a BMI2 target (-mbmi2 or -march=native)"
+#endif
+constexpr const char* slidingAttacksName = "pext";
+#elif defined(SLIDERS_FANCY)
+constexpr const char* slidingAttacksName = "fancy magic";
+#else
+constexpr const char* slidingAttacksName = "magic";
+#endif
+
 enum class SlidingPiece : std::uint8_t {
     Rook,
     Bishop
 };
 
+struct SlidingAttacks {    // per square entry of the packed sliding attacks table
+    Bitboard mask;
+    Bitboard magic;
+    const Bitboard* attacks;
+    std::uint8_t shift;
+};
+
+constexpr std::uint32_t rookPackedTableSize = 102400;
+constexpr std::uint32_t bishopPackedTableSize = 5248;
+
 extern Bitboard knightAttacks[64];
 extern Bitboard kingAttacks[64];
 extern Bitboard pawnAttacks[2][64];
+#if defined(SLIDERS_PEXT) || defined(SLIDERS_FANCY)
+extern Bitboard slidingAttacksTable[rookPackedTableSize + bishopPackedTableSize];
+extern SlidingAttacks rookSlidingAttacks[64];
+extern SlidingAttacks bishopSlidingAttacks[64];
+#else
 extern Bitboard rookAttacks[64][4096];
 extern Bitboard bishopAttacks[64][512];
+#endif
+
+extern Bitboard betweenBitboards[64][64];
+extern Bitboard lineBitboards[64][64];
 
 extern Bitboard rookMasks[64];
 extern Bitboard bishopMasks[64];
 
-extern Bitboard rookMagics[64];
-extern Bitboard bishopMagics[64];
 extern std::uint8_t rookMagicShifts[64];
 extern std::uint8_t bishopMagicShifts[64];
 
@@ -33,6 +66,7 @@ void initPawnAttacks();
 void initRookAttacks();
 void initBishopAttacks();
 void initSlidingAttacks(SlidingPiece piece);
+void initLineBitboards();
 
 void initRookMasks();
 void initBishopMasks();
@@ -40,10 +74,9 @@ void initBishopMasks();
 void initRookShifts();
 void initBishopShifts();
 
-void initRookMagics();
-void initBishopMagics();
-
 Bitboard findMagic(Square square, SlidingPiece piece);
+void printMagics();    // offline generator of magics.hpp
+std::uint64_t getSlidingAttacksTableSize();
 
 Bitboard getKnightAttacks(Square square);
 Bitboard getKingAttacks(Square square);
@@ -51,6 +84,8 @@ Bitboard getPawnAttacks(Square square, Color color);
 Bitboard getRookAttacks(Square square, Bitboard occupied);
 Bitboard getBishopAttacks(Square square, Bitboard occupied);
 Bitboard getQueenAttacks(Square square, Bitboard occupied);
+Bitboard getBetween(Square square1, Square square2);
+Bitboard getLine(Square square1, Square square2);
 
 Bitboard getRookAttacksOTF(Square square, Bitboard occupied);
 Bitboard getBishopAttacksOTF(Square square, Bitboard occupied);
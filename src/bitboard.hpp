@@ -68,6 +68,7 @@ public:
 
     explicit constexpr operator bool() const { return value != 0ULL; }
     explicit constexpr operator std::uint16_t() const { return static_cast<std::uint16_t>(value); }
+    explicit constexpr operator std::uint64_t() const { return value; }
 
     friend std::ostream& operator<<(std::ostream& output, const Bitboard& bb); // output operator
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "piece.hpp"
+#include "zobrist.hpp"
+
+#include <cstdint>
+#include <utility>
+
+// Cuckoo hash table of the reversible moves of non pawn pieces, keyed by the hash difference between the positions
+// before and after the move (both piece squares and the side to move), used to detect that a previous position
+// can be reached again in one move
+constexpr std::uint32_t cuckooTableSize = 8192;
+constexpr std::uint32_t cuckooMoveCount = 3668;
+
+constexpr std::uint32_t cuckooIndex1(std::uint64_t key) { return key & (cuckooTableSize - 1); }
+constexpr std::uint32_t cuckooIndex2(std::uint64_t key) { return (key >> 16) & (cuckooTableSize - 1); }
+
+struct CuckooTable {
+    std::uint64_t keys[cuckooTableSize];
+    std::uint8_t from[cuckooTableSize];
+    std::uint8_t to[cuckooTableSize];
+    std::uint32_t count;
+};
+
+constexpr bool isPieceMove(PieceType pieceType, std::uint8_t from, std::uint8_t to) {   // on an empty board
+    const std::int32_t rankDistance = (from / 8 > to / 8) ? from / 8 - to / 8 : to / 8 - from / 8;
+    const std::int32_t fileDistance = (from % 8 > to % 8) ? from % 8 - to % 8 : to % 8 - from % 8;
+    const bool rookMove = rankDistance == 0 || fileDistance == 0;
+    const bool bishopMove = rankDistance == fileDistance;
+
+    switch (pieceType) {
+        case PieceType::Knight: return rankDistance * fileDistance == 2;
+        case PieceType::Bishop: return bishopMove;
+        case PieceType::Rook:   return rookMove;
+        case PieceType::Queen:  return rookMove || bishopMove;
+        case PieceType::King:   return rankDistance <= 1 && fileDistance <= 1;
+        default:                return false;
+    }
+}
+
+constexpr CuckooTable generateCuckooTable() {
+    CuckooTable table {};
+
+    for (std::uint8_t piece = 0; piece < 12; piece++) {
+        const PieceType pieceType = getPieceType(static_cast<Piece>(piece));
+        if (pieceType == PieceType::Pawn) continue;
+
+        for (std::uint8_t from = 0; from < 64; from++) {
+            for (std::uint8_t to = from + 1; to < 64; to++) {
+                if (!isPieceMove(pieceType, from, to)) continue;
+
+                std::uint64_t key = pieceSquareZobristHash[piece][from] ^ pieceSquareZobristHash[piece][to] ^ colorZobristHash;
+                std::uint8_t keyFrom = from, keyTo = to;
+                std::uint32_t index = cuckooIndex1(key);
+
+                // insert, evicting the current entry to its other slot until an empty slot is found
+                for (;;) {
+                    std::swap(table.keys[index], key);
+                    std::swap(table.from[index], keyFrom);
+                    std::swap(table.to[index], keyTo);
+                    if (key == 0) break;
+                    index = (index == cuckooIndex1(key)) ? cuckooIndex2(key) : cuckooIndex1(key);
+                }
+                table.count++;
+            }
+        }
+    }
+
+    return table;
+}
+
+inline constexpr CuckooTable cuckooTable = generateCuckooTable();
+static_assert(cuckooTable.count == cuckooMoveCount, "unexpected number of reversible moves in the cuckoo table");
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <array>
+#include <cstdint>
+
+constexpr std::uint32_t evalCacheSize = 16384; // entries per thread, has to be a power of two
+
+class EvalCache {   // per thread cache of static evaluations, an entry packs the upper 48 bits of the hash with the 16 bit score
+public:
+    bool probe(std::uint64_t hash, Score& outEval) const {
+        const std::uint64_t entry = table[hash & (evalCacheSize - 1)];
+        if ((entry ^ hash) & keyMask) return false;
+
+        outEval = static_cast<Score>(entry & ~keyMask);
+        return true;
+    }
+    void store(std::uint64_t hash, Score eval) {
+        table[hash & (evalCacheSize - 1)] = (hash & keyMask) | static_cast<std::uint16_t>(eval);
+    }
+
+private:
+    static constexpr std::uint64_t keyMask = ~0xFFFFULL;
+
+    std::array<std::uint64_t, evalCacheSize> table {};
+};
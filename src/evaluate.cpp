@@ -6,60 +6,49 @@ Bitboard passedPawnSpans[2][64];
 Bitboard isolatedPawnSpans[8];
 
 Score evaluate(const Position &position) {
-    EvaluationData evaluationData{};
-    initializeEvaluationData(position, evaluationData);
+    PawnEntry pawnEntry{};
+    evaluatePawnStructure(position, pawnEntry);
 
-    ScoreExt materialScore = evaluateMaterial(evaluationData);
-    ScoreExt pawnScore = evaluatePawns<Color::White>(position) - evaluatePawns<Color::Black>(position);
+    return evaluateWithPawnScore(position, pawnEntry.score);
+}
+
+Score evaluate(const Position &position, PawnHashTable& pawnHashTable) {
+    PawnEntry& pawnEntry = pawnHashTable.getEntry(position.pawnHash);
+
+    pawnHashTable.probes++;
+    if (pawnEntry.key == position.pawnHash) {
+        pawnHashTable.hits++;
+    }
+    else {
+        evaluatePawnStructure(position, pawnEntry);
+    }
+
+    return evaluateWithPawnScore(position, pawnEntry.score);
+}
+
+void evaluatePawnStructure(const Position& position, PawnEntry& pawnEntry) {
+    pawnEntry.key = position.pawnHash;
+    pawnEntry.score = evaluatePawns<Color::White>(position) - evaluatePawns<Color::Black>(position);
+}
+
+Score evaluateWithPawnScore(const Position &position, ScoreExt pawnScore) {
+    // material and PSQT are kept up to date by the position, only the non incremental terms are computed here
     ScoreExt pieceScore =
             evaluatePieces<PieceType::Knight, Color::White>(position) - evaluatePieces<PieceType::Knight, Color::Black>(position) +
             evaluatePieces<PieceType::Bishop, Color::White>(position) - evaluatePieces<PieceType::Bishop, Color::Black>(position) +
             evaluatePieces<PieceType::Rook, Color::White>(position) - evaluatePieces<PieceType::Rook, Color::Black>(position) +
             evaluatePieces<PieceType::Queen, Color::White>(position) - evaluatePieces<PieceType::Queen, Color::Black>(position);
-    ScoreExt kingScore = evaluateKing<Color::White>(position) - evaluateKing<Color::Black>(position);
 
-    ScoreExt finalScore = materialScore + pawnScore + pieceScore + kingScore;
+    ScoreExt finalScore = position.psqtScore + pawnScore + pieceScore;
 
-    evaluatePhase(evaluationData);
-    Score evaluation = interpolateScore(finalScore, evaluationData);
+    Score evaluation = interpolateScore(finalScore, position.phase);
 
     evaluation = (position.sideToMove == Color::White) ? evaluation : -evaluation;
     return evaluation + tempoBonus;
 }
 
-void evaluatePhase(EvaluationData& evaluationData) {
-    evaluationData.phase = (evaluationData.whiteKnightCount + evaluationData.blackKnightCount) * knightPhaseValue
-                         + (evaluationData.whiteBishopCount + evaluationData.blackBishopCount) * bishopPhaseValue
-                         + (evaluationData.whiteRookCount + evaluationData.blackRookCount) * rookPhaseValue
-                         + (evaluationData.whiteQueenCount + evaluationData.blackQueenCount) * queenPhaseValue;
-}
-
-Score interpolateScore(ScoreExt finalScore, EvaluationData& evaluationData) {
-    return  (finalScore.mg * evaluationData.phase + finalScore.eg * (phaseMidGame - evaluationData.phase)) / phaseMidGame;
-}
-
-void initializeEvaluationData(const Position& position, EvaluationData& evaluationData) {
-    evaluationData.whitePawnCount = position.white.pawns.count();
-    evaluationData.whiteKnightCount = position.white.knights.count();
-    evaluationData.whiteBishopCount = position.white.bishops.count();
-    evaluationData.whiteRookCount = position.white.rooks.count();
-    evaluationData.whiteQueenCount = position.white.queens.count();
-
-    evaluationData.blackPawnCount = position.black.pawns.count();
-    evaluationData.blackKnightCount = position.black.knights.count();
-    evaluationData.blackBishopCount = position.black.bishops.count();
-    evaluationData.blackRookCount = position.black.rooks.count();
-    evaluationData.blackQueenCount = position.black.queens.count();
-}
-
-ScoreExt evaluateMaterial(EvaluationData& evaluationData) {
-    ScoreExt score = (evaluationData.whitePawnCount - evaluationData.blackPawnCount) * pawnValue
-                + (evaluationData.whiteKnightCount - evaluationData.blackKnightCount) * knightValue
-                + (evaluationData.whiteBishopCount - evaluationData.blackBishopCount) * bishopValue
-                + (evaluationData.whiteRookCount - evaluationData.blackRookCount) * rookValue
-                + (evaluationData.whiteQueenCount - evaluationData.blackQueenCount) * queenValue;
-
-    return score;
+Score interpolateScore(ScoreExt finalScore, std::int32_t phase) {
+    return  (finalScore.mg * phase + finalScore.eg * (phaseMidGame - phase)) / phaseMidGame;
 }
 
 template <Color color>
@@ -74,9 +63,6 @@ ScoreExt evaluatePawns(const Position &position) {
     while (tempPawns) {
         Square square = tempPawns.popLsb();
 
-        // PSQT
-        score += (color == Color::White) ? pawnSquareTable[square.index()] : pawnSquareTable[square.flipIndex()];
-
         // Pawn structure
         Bitboard pawnsOnFile = ourPawns & Bitboard::FileBitboard(square.file());
         Bitboard stoppers = passedPawnSpans[static_cast<std::uint8_t>(color)][square.index()] & theirPawns;
@@ -107,12 +93,9 @@ ScoreExt evaluatePieces(const Position& position) {
     while (pieceBitboard) {
         Square square = pieceBitboard.popLsb();
 
-        // PSQT
-        score += (color == Color::White) ? pieceSquareTable[static_cast<std::uint8_t>(pieceType)][square.index()] : pieceSquareTable[static_cast<std::uint8_t>(pieceType)][square.flipIndex()];
-
         // Mobility
         if constexpr (pieceType == PieceType::Knight || pieceType == PieceType::Bishop || pieceType == PieceType::Rook || pieceType == PieceType::Queen) {
-            Bitboard attacks = getAttacks<pieceType, color>(square, position.occupied);
+            Bitboard attacks = getAttacks<pieceType, color>(square, position.getOccupied());
             score += mobilityBonus[static_cast<std::uint8_t>(pieceType) - 1][attacks.count()];
         }
 
@@ -139,38 +122,25 @@ ScoreExt evaluatePieces(const Position& position) {
     return score;
 }
 
-template<Color color>
-ScoreExt evaluateKing(const Position &position) {
-    Bitboard kingBitboard = (color == Color::White) ? position.white.king : position.black.king;
-    Square kingSquare = kingBitboard.popLsb();
-
-    // PSQT
-    ScoreExt score = (color == Color::White) ? kingSquareTable[kingSquare.index()] : kingSquareTable[kingSquare.flipIndex()];
-
-    return score;
-}
-
 bool checkInsufficientMaterial(const Position &position) {
-    Bitboard pawnRookQueenBitboard =
-            position.white.pawns | position.white.rooks | position.white.queens |
-            position.black.pawns | position.black.rooks | position.black.queens;
+    Bitboard pawnRookQueenBitboard = position.getPieces(PieceType::Pawn) | position.getPieces(PieceType::Rook) | position.getPieces(PieceType::Queen);
 
     if (pawnRookQueenBitboard) return false;
 
-    if (position.white.bishops == 0 && position.black.bishops == 0) {
+    if (position.getPieces<Piece::WhiteBishop>() == 0 && position.getPieces<Piece::BlackBishop>() == 0) {
         // knight & king vs king
-        if ((position.white.knights == 0 && position.black.knights.count() < 2) ||
-            (position.black.knights == 0 && position.white.knights.count() <2)) return true;
+        if ((position.getPieces<Piece::WhiteKnight>() == 0 && position.getPieces<Piece::BlackKnight>().count() < 2) ||
+            (position.getPieces<Piece::BlackKnight>() == 0 && position.getPieces<Piece::WhiteKnight>().count() <2)) return true;
     }
 
-    if (position.white.knights == 0 && position.black.knights == 0) {
+    if (position.getPieces<Piece::WhiteKnight>() == 0 && position.getPieces<Piece::BlackKnight>() == 0) {
         // bishop & king vs king
-        if ((position.white.bishops == 0 && position.black.bishops.count() < 2) ||
-            (position.black.bishops == 0 && position.white.bishops.count() < 2)) return true;
+        if ((position.getPieces<Piece::WhiteBishop>() == 0 && position.getPieces<Piece::BlackBishop>().count() < 2) ||
+            (position.getPieces<Piece::BlackBishop>() == 0 && position.getPieces<Piece::WhiteBishop>().count() < 2)) return true;
         // bishop & king vs bishop & king on same color
-        if (position.white.bishops.count() == 1 && position.black.bishops.count() == 1) {
-            Bitboard lightSquareBishops = (position.white.bishops | position.black.bishops) & Bitboard::LightSquares();
-            Bitboard darkSquareBishops = (position.white.bishops | position.black.bishops) & Bitboard::DarkSquares();
+        if (position.getPieces<Piece::WhiteBishop>().count() == 1 && position.getPieces<Piece::BlackBishop>().count() == 1) {
+            Bitboard lightSquareBishops = position.getPieces(PieceType::Bishop) & Bitboard::LightSquares();
+            Bitboard darkSquareBishops = position.getPieces(PieceType::Bishop) & Bitboard::DarkSquares();
             if (darkSquareBishops == 0 || lightSquareBishops == 0) return true;
         }
     }
@@ -12,10 +12,10 @@ private:
     Position currentPosition;
     bool valid = false;
 public:
-    bool checkRepetition(std::uint64_t hash) const;
     void recordPosition(Position& position);
     void reset();
     constexpr Position getCurrentPosition() const { return currentPosition; };
+    const std::vector<std::uint64_t>& getPositionHistory() const { return positionHistory; };   // hashes of the game positions, the current one last
     constexpr bool isValid() const { return valid; };
     constexpr Color getSideToMove() const { return currentPosition.sideToMove; };
 };
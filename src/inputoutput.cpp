@@ -0,0 +1,100 @@
+#include "inputoutput.hpp"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+CommandReader::CommandReader() : commandQueue{std::make_shared<CommandQueue>()} {
+    // reading std::cin would flush std::cout from the reader thread, output is flushed by its writers instead
+    std::cin.tie(nullptr);
+    std::thread(&CommandReader::readLoop, commandQueue).detach();
+}
+
+void CommandReader::readLoop(std::shared_ptr<CommandQueue> commandQueue) {
+    std::string command;
+    bool endOfInput = false;
+
+    while (!endOfInput) {
+        if (!std::getline(std::cin, command)) {
+            command = "quit";
+            endOfInput = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(commandQueue->mutex);
+            commandQueue->commands.push_back(std::move(command));
+        }
+        commandQueue->condition.notify_one();
+    }
+}
+
+std::string CommandReader::waitCommand() {
+    std::unique_lock<std::mutex> lock(commandQueue->mutex);
+    commandQueue->condition.wait(lock, [&] { return !commandQueue->commands.empty(); });
+
+    std::string command = std::move(commandQueue->commands.front());
+    commandQueue->commands.pop_front();
+    return command;
+}
+
+
+static std::mutex outputMutex;
+static std::condition_variable outputCondition;
+static std::vector<std::string> pendingLines;
+static std::thread outputThread;
+static bool outputRunning = false;
+static bool exitOutput = false;
+
+static void outputLoop() {
+    std::vector<std::string> lines;
+    std::unique_lock<std::mutex> lock(outputMutex);
+
+    for (;;) {
+        outputCondition.wait(lock, [] { return exitOutput || !pendingLines.empty(); });
+        if (pendingLines.empty()) return;
+
+        // the lines are written outside of the lock so that writers only wait for the queue
+        std::swap(lines, pendingLines);
+        lock.unlock();
+
+        for (const std::string& line : lines) std::cout << line << '\n';
+        std::cout.flush();
+        lines.clear();
+
+        lock.lock();
+    }
+}
+
+void startOutput() {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (outputRunning) return;
+
+    exitOutput = false;
+    outputRunning = true;
+    outputThread = std::thread(outputLoop);
+}
+
+void stopOutput() {
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (!outputRunning) return;
+        exitOutput = true;
+    }
+    outputCondition.notify_all();
+    outputThread.join();
+
+    std::lock_guard<std::mutex> lock(outputMutex);
+    outputRunning = false;
+}
+
+void writeString(std::string line) {
+    std::unique_lock<std::mutex> lock(outputMutex);
+    if (!outputRunning) {
+        std::cout << line << std::endl;
+        return;
+    }
+
+    pendingLines.push_back(std::move(line));
+    lock.unlock();
+    outputCondition.notify_all();
+}
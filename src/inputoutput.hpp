@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Reads stdin on its own thread and queues the commands for the controller, which sleeps until a command arrives.
+// End of input is turned into a quit command.
+class CommandReader {
+public:
+    CommandReader();
+
+    std::string waitCommand();
+
+private:
+    struct CommandQueue {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::string> commands;
+    };
+
+    // shared with the reader thread, which is detached as it may stay blocked on stdin until the process exits
+    std::shared_ptr<CommandQueue> commandQueue;
+
+    static void readLoop(std::shared_ptr<CommandQueue> commandQueue);
+};
+
+// All engine output goes through writeLine. Lines written while the output thread runs are queued and written to
+// stdout by that thread only, so that output is never interleaved and a slow reader of the pipe never blocks a search
+// thread. Without the output thread lines are written directly.
+void startOutput();
+void stopOutput();              // writes the pending lines first
+void writeString(std::string line);
+
+template <typename... Args>
+void writeLine(const Args&... args) {
+    std::ostringstream line;
+    (line << ... << args);
+    writeString(line.str());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "bitboard.hpp"
+
+// magic numbers of the sliding attack tables, generated offline by findMagic (run the engine with the `magics` argument)
+
+constexpr Bitboard rookMagics[64] = {
+    0x0280008350204000ULL, 0x0040200040001001ULL, 0x108010010b802000ULL, 0x0100091000050120ULL,
+    0x0a00249022002008ULL, 0x0200040108020010ULL, 0x0400144088010210ULL, 0x81800c30c0800100ULL,
+    0x0000800020804000ULL, 0x4050400040201008ULL, 0x0080802000100088ULL, 0x0c25002090000b00ULL,
+    0x8001000800100500ULL, 0x4001000900040002ULL, 0x008c000410080142ULL, 0x0081000100008042ULL,
+    0x8080044000200844ULL, 0x0670004000200040ULL, 0x0020018010002180ULL, 0x4041090020100500ULL,
+    0x0100808008000402ULL, 0x0000808002000400ULL, 0x1000040001021008ULL, 0x8050020000491084ULL,
+    0x0001c00280008024ULL, 0x5000200040401000ULL, 0x9024100080200480ULL, 0x8010080080801000ULL,
+    0x000a040080080080ULL, 0x4001000900040002ULL, 0x0000880400410210ULL, 0x0081000100008042ULL,
+    0x81288540008002b1ULL, 0x5000200040401000ULL, 0x5000110041002001ULL, 0x8010080080801000ULL,
+    0x4000800800800401ULL, 0x0440020080800400ULL, 0xc418080204000150ULL, 0x0404004c82001114ULL,
+    0x4002090080460020ULL, 0x4002090080460020ULL, 0x0000402001010010ULL, 0x0082100100090020ULL,
+    0x0000080005010010ULL, 0x0202020004008080ULL, 0x0878010230040098ULL, 0x02004040840a0011ULL,
+    0x0080804201002600ULL, 0x0050442482010600ULL, 0x8900801000200880ULL, 0x0c25002090000b00ULL,
+    0x8001000800100500ULL, 0x0004800201040080ULL, 0x0082821001080400ULL, 0x3200008061140200ULL,
+    0x0202144300208001ULL, 0x0003008810204202ULL, 0x0010104200088022ULL, 0x0200201001000409ULL,
+    0x0802000420100802ULL, 0x0081000c0002480bULL, 0x4001000200088c21ULL, 0x00008403408d0022ULL,
+};
+
+constexpr Bitboard bishopMagics[64] = {
+    0x0008420808050010ULL, 0x0042109101010409ULL, 0x20500c0040482224ULL, 0x3008208020048040ULL,
+    0x05040420000a0884ULL, 0x004104024000cd80ULL, 0x80010108a0040000ULL, 0x0114808808010511ULL,
+    0x000040100a2a8128ULL, 0x300004d004044a80ULL, 0x0211042802004040ULL, 0x8014112400810400ULL,
+    0x000001104000c0e8ULL, 0x0001520111084280ULL, 0x0001520111084280ULL, 0x0001520111084280ULL,
+    0x0008001002880844ULL, 0x0008001002880844ULL, 0x004c000800440808ULL, 0xe204002202920028ULL,
+    0x01040002012124a0ULL, 0x0022000100410400ULL, 0x0012109080842020ULL, 0x1880410203041900ULL,
+    0x1210088110021006ULL, 0x2004208010010100ULL, 0x0008042008002020ULL, 0x41c0040012101010ULL,
+    0x4030101021004000ULL, 0x04500d0010804100ULL, 0x0001005006080402ULL, 0x0004091010808080ULL,
+    0x051ea010c0204200ULL, 0x0004881820600288ULL, 0x0108250100300408ULL, 0x0104020080080081ULL,
+    0x0010088200042200ULL, 0x8010020201002080ULL, 0x0001842400008200ULL, 0x4118106080404a00ULL,
+    0x00a4104210800801ULL, 0x181c046208010200ULL, 0x0002082088001000ULL, 0x0020002204200801ULL,
+    0x3000401011000210ULL, 0x0088421084080200ULL, 0x0088421084080200ULL, 0x0410840110240440ULL,
+    0x80010108a0040000ULL, 0x1900848848020002ULL, 0x0085a03084100010ULL, 0x0004608020880045ULL,
+    0x2000221002021420ULL, 0x0a01040830410500ULL, 0xa804080208220000ULL, 0x0042109101010409ULL,
+    0x0114808808010511ULL, 0x0001520111084280ULL, 0x0182040304880420ULL, 0xe000188405048820ULL,
+    0x20500c0040482224ULL, 0x0008001002880844ULL, 0x000040100a2a8128ULL, 0x0008420808050010ULL,
+};
@@ -3,13 +3,11 @@
 #include "evaluate.hpp"
 #include "universalchessinterface.hpp"
 #include "search.hpp"
-#include "zobrist.hpp"
 
 
 int main(int argc, char **argv)
 {
     initAttacks();
-    initZobristKeys();
     initSearchParameters();
     initEvaluationParameters();
 
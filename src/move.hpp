@@ -54,6 +54,7 @@ public:
                                                                                           (static_cast<std::uint32_t>(enpassant) << 22) |
                                                                                           (static_cast<std::uint32_t>(castling) << 23) ) {};
 
+    constexpr std::uint32_t getValue() const { return value; }
     constexpr Square getFrom() const { return static_cast<Square>(value & 0x3f); }
     constexpr Square getTo() const { return static_cast<Square>((value >> 6) & 0x3f); }
     constexpr Piece getPiece() const { return static_cast<Piece>((value >> 12) & 0xf); }
@@ -72,7 +73,7 @@ public:
 
     friend std::ostream& operator<<(std::ostream& output, const Move& move) {
         if (!move.isValid()) {
-            std::cout << "INVALID MOVE"; return output;
+            output << "INVALID MOVE"; return output;
         }
         if (move.isPromotion()) {
             output << move.getFrom() << move.getTo() << pieceNames[static_cast<std::uint8_t>(move.getPromotionPiece())];
@@ -13,8 +13,72 @@ enum class MoveType {
     QuietMoves,
 };
 
-template <MoveType moveType, Color color>
-void generatePawnMoves(MoveList& moveList, const Position& position) {
+// in legal mode, moves are filtered with the check and pin information of the position
+template <bool legal>
+inline bool isPinnedMoveAllowed(const CheckInfo& checkInfo, const Square from, const Square to) {
+    if constexpr (!legal) return true;
+    return !(checkInfo.pinned & from) || static_cast<bool>(getLine(checkInfo.kingSquare, from) & to);
+}
+
+template <Color color, bool legal>
+void generatePromotions(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
+    constexpr Color opponent = ~color;
+    constexpr Direction forward = (color == Color::White) ? Direction::North : Direction::South;
+    constexpr Direction backward = (color == Color::White) ? Direction::South : Direction::North;
+    constexpr Bitboard promotionRank = (color == Color::White) ? Bitboard::RankBitboard(6) : Bitboard::RankBitboard(1);
+    constexpr Piece pawn = (color == Color::White) ? Piece::WhitePawn : Piece::BlackPawn;
+
+    Bitboard pawnsOnPromotionRank = position.getPieces<pawn>() & promotionRank;
+    if (!pawnsOnPromotionRank) return;
+
+    Bitboard emptySquares = ~position.getOccupied();
+    Bitboard opponentPieces = position.getOccupied<opponent>();
+    const Bitboard targetMask = legal ? checkInfo.evasionMask : ~Bitboard(0ULL);
+
+    Bitboard capturesRight = pawnsOnPromotionRank.template shift<forward>().template shift<Direction::East>() & opponentPieces & targetMask;
+    Bitboard capturesLeft = pawnsOnPromotionRank.template shift<forward>(). template shift<Direction::West>() & opponentPieces & targetMask;
+    Bitboard nonCaptures = pawnsOnPromotionRank.shift<forward>() & emptySquares & targetMask;
+
+    while (capturesRight) {
+        Square to = capturesRight.popLsb();
+        Square from = to.template shift<backward>().template shift<Direction::West>();
+        if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+            moveList.addPromotion(from, to, pawn, true, color);
+    }
+
+    while (capturesLeft) {
+        Square to = capturesLeft.popLsb();
+        Square from = to.template shift<backward>().template shift<Direction::East>();
+        if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+            moveList.addPromotion(from, to, pawn, true, color);
+    }
+
+    while (nonCaptures) {
+        Square to = nonCaptures.popLsb();
+        Square from = to.shift<backward>();
+        if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+            moveList.addPromotion(from, to, pawn, color);
+    }
+}
+
+template <Color color, bool legal>
+void generateEnPassant(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
+    constexpr Color opponent = ~color;
+    constexpr Piece pawn = (color == Color::White) ? Piece::WhitePawn : Piece::BlackPawn;
+
+    if (position.enPassantSquare == Square::None) return;
+
+    Bitboard pawnAbleToCapture = getPawnAttacks(position.enPassantSquare, opponent) & position.getPieces<pawn>();
+    while (pawnAbleToCapture) {
+        Square from = pawnAbleToCapture.popLsb();
+        Move move {from, position.enPassantSquare, pawn, true, false, true, false};
+        if (!legal || position.isLegalEnPassant(move, checkInfo))
+            moveList.addMove(move);
+    }
+}
+
+template <MoveType moveType, Color color, bool legal>
+void generatePawnMoves(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
     constexpr Color opponent = ~color;
     constexpr Direction forward = (color == Color::White) ? Direction::North : Direction::South;
     constexpr Direction backward = (color == Color::White) ? Direction::South : Direction::North;
@@ -23,88 +87,63 @@ void generatePawnMoves(MoveList& moveList, const Position& position) {
     constexpr Piece pawn = (color == Color::White) ? Piece::WhitePawn : Piece::BlackPawn;
 
     Bitboard pawns = position.getPieces<pawn>();
-    Bitboard pawnsOnPromotionRank = pawns & promotionRank;
     Bitboard pawnsNotOnPromotionRank = pawns & ~promotionRank;
 
-    Bitboard emptySquares = ~position.occupied;
+    Bitboard emptySquares = ~position.getOccupied();
     Bitboard opponentPieces = position.getOccupied<opponent>();
+    const Bitboard targetMask = legal ? checkInfo.evasionMask : ~Bitboard(0ULL);
 
     // generate pawns pushes
     if constexpr (moveType == MoveType::QuietMoves || moveType == MoveType::AllMoves) {
-        Bitboard singlePushes = pawnsNotOnPromotionRank.shift<forward>() & ~position.occupied;
-        Bitboard doublePushes = (singlePushes & doublePushRank).shift<forward>() & emptySquares;
+        Bitboard singlePushes = pawnsNotOnPromotionRank.shift<forward>() & ~position.getOccupied();
+        Bitboard doublePushes = (singlePushes & doublePushRank).shift<forward>() & emptySquares & targetMask;
+        singlePushes &= targetMask;
 
         while (singlePushes) {
             Square to = singlePushes.popLsb();
             Square from = to.shift<backward>();
-            moveList.addMove(from, to, pawn);
+            if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+                moveList.addMove(from, to, pawn);
         }
 
         while (doublePushes) {
             Square to = doublePushes.popLsb();
             Square from = to.template shift<backward>().
                     template shift<backward>();
-            moveList.addDoublePush(from, to, pawn);
+            if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+                moveList.addDoublePush(from, to, pawn);
         }
     }
 
     // generate pawn promotions
     if constexpr (moveType == MoveType::NonQuietMoves || moveType == MoveType::AllMoves) {
-        if (pawnsOnPromotionRank) {
-            Bitboard capturesRight = pawnsOnPromotionRank.template shift<forward>().template shift<Direction::East>() & opponentPieces;
-            Bitboard capturesLeft = pawnsOnPromotionRank.template shift<forward>(). template shift<Direction::West>() & opponentPieces;
-            Bitboard nonCaptures = pawnsOnPromotionRank.shift<forward>() & emptySquares;
-
-            while (capturesRight) {
-                Square to = capturesRight.popLsb();
-                Square from = to.template shift<backward>().template shift<Direction::West>();
-                moveList.addPromotion(from, to, pawn, true, color);
-            }
-
-            while (capturesLeft) {
-                Square to = capturesLeft.popLsb();
-                Square from = to.template shift<backward>().template shift<Direction::East>();
-                moveList.addPromotion(from, to, pawn, true, color);
-            }
-
-            while (nonCaptures) {
-                Square to = nonCaptures.popLsb();
-                Square from = to.shift<backward>();
-                moveList.addPromotion(from, to, pawn, color);
-            }
-        }
+        generatePromotions<color, legal>(moveList, position, checkInfo);
     }
 
     // generate pawn captures
     if constexpr (moveType == MoveType::NonQuietMoves || moveType == MoveType::AllMoves) {
         Bitboard capturesRight = pawnsNotOnPromotionRank.template shift<forward>().
-                template shift<Direction::East>() & opponentPieces;
+                template shift<Direction::East>() & opponentPieces & targetMask;
         Bitboard capturesLeft = pawnsNotOnPromotionRank.template shift<forward>().
-                template shift<Direction::West>() & opponentPieces;
+                template shift<Direction::West>() & opponentPieces & targetMask;
 
         while (capturesRight) {
             Square to = capturesRight.popLsb();
             Square from = to.template shift<backward>().
                     template shift<Direction::West>();
-            moveList.addMove(from, to, pawn, true);
+            if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+                moveList.addMove(from, to, pawn, true);
         }
 
         while (capturesLeft) {
             Square to = capturesLeft.popLsb();
             Square from = to.template shift<backward>().
                     template shift<Direction::East>();
-            moveList.addMove(from, to, pawn, true);
+            if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+                moveList.addMove(from, to, pawn, true);
         }
 
-        if (position.enPassantSquare != Square::None) {
-            Bitboard pawnAbleToCapture =
-                    getPawnAttacks(position.enPassantSquare, opponent) & pawnsNotOnPromotionRank;
-
-            while (pawnAbleToCapture) {
-                Square from = pawnAbleToCapture.popLsb();
-                moveList.addEnPassant(from, position.enPassantSquare, pawn);
-            }
-        }
+        generateEnPassant<color, legal>(moveList, position, checkInfo);
     }
 }
 
@@ -117,7 +156,7 @@ void generateCastlingMoves(MoveList& moveList, const Position& position) {
             const Square sq1 = Square::F1;
             const Square sq2 = Square::G1;
             const Bitboard between = Bitboard(sq1) | Bitboard(sq2);
-            const Bitboard occupiedSquares = position.occupied & between;
+            const Bitboard occupiedSquares = position.getOccupied() & between;
             if (occupiedSquares == 0ULL) {
                 if (!position.isSquareAttackedBy<opponent>(Square::E1) && !position.isSquareAttackedBy<opponent>(
                         Square::F1) && !position.isSquareAttackedBy<opponent>(
@@ -132,7 +171,7 @@ void generateCastlingMoves(MoveList& moveList, const Position& position) {
             const Square sq2 = Square::C1;
             const Square sq3 = Square::D1;
             const Bitboard between = Bitboard(sq1) | Bitboard(sq2) | Bitboard(sq3);
-            const Bitboard occupiedSquares = position.occupied & between;
+            const Bitboard occupiedSquares = position.getOccupied() & between;
             if (occupiedSquares == 0ULL) {
                 if (!position.isSquareAttackedBy<opponent>(Square::E1) && !position.isSquareAttackedBy<opponent>(
                         Square::D1) && !position.isSquareAttackedBy<opponent>(
@@ -148,7 +187,7 @@ void generateCastlingMoves(MoveList& moveList, const Position& position) {
             const Square sq1 = Square::F8;
             const Square sq2 = Square::G8;
             const Bitboard between = Bitboard(sq1) | Bitboard(sq2);
-            const Bitboard occupiedSquares = position.occupied & between;
+            const Bitboard occupiedSquares = position.getOccupied() & between;
             if (occupiedSquares == 0ULL) {
                 if (!position.isSquareAttackedBy<opponent>(Square::E8) && !position.isSquareAttackedBy<opponent>(
                         Square::F8) && !position.isSquareAttackedBy<opponent>(
@@ -163,7 +202,7 @@ void generateCastlingMoves(MoveList& moveList, const Position& position) {
             const Square sq2 = Square::C8;
             const Square sq3 = Square::D8;
             const Bitboard between = Bitboard(sq1) | Bitboard(sq2) | Bitboard(sq3);
-            const Bitboard occupiedSquares = position.occupied & between;
+            const Bitboard occupiedSquares = position.getOccupied() & between;
             if (occupiedSquares == 0ULL) {
                 if (!position.isSquareAttackedBy<opponent>(Square::E8) && !position.isSquareAttackedBy<opponent>(
                         Square::D8) && !position.isSquareAttackedBy<opponent>(
@@ -176,8 +215,8 @@ void generateCastlingMoves(MoveList& moveList, const Position& position) {
     }
 }
 
-template <MoveType moveType, Piece piece>
-void generatePieceMoves(MoveList& moveList, const Position& position) {
+template <MoveType moveType, Piece piece, bool legal>
+void generatePieceMoves(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
     constexpr Color color = getPieceColor(piece);
     constexpr Color opponent = ~color;
     constexpr PieceType pieceType = getPieceType(piece);
@@ -187,42 +226,130 @@ void generatePieceMoves(MoveList& moveList, const Position& position) {
         filter &= ~position.getOccupied<opponent>();
     if constexpr (moveType == MoveType::NonQuietMoves)
         filter &= position.getOccupied<opponent>();
-
+    if constexpr (legal && pieceType != PieceType::King)
+        filter &= checkInfo.evasionMask;
 
     Bitboard pieces = position.getPieces<piece>();
+    // a pinned knight can never move
+    if constexpr (legal && pieceType == PieceType::Knight)
+        pieces &= ~checkInfo.pinned;
+
     while (pieces) {
         Square from = pieces.popLsb();
-        Bitboard attacks = getAttacks<pieceType, color>(from, position.occupied);
+        Bitboard attacks = getAttacks<pieceType, color>(from, position.getOccupied());
         Bitboard targets = attacks & filter;
+        if constexpr (legal && pieceType != PieceType::King)
+            if (checkInfo.pinned & from) targets &= getLine(checkInfo.kingSquare, from);
 
         while (targets) {
             Square to = targets.popLsb();
-            moveList.addMove(from, to, piece, static_cast<bool>(position.occupied & to));
+            Move move {from, to, piece, static_cast<bool>(position.getOccupied() & to), false, false, false};
+            if constexpr (legal && pieceType == PieceType::King)
+                if (!position.isLegal(move, checkInfo)) continue;
+            moveList.addMove(move);
         }
     }
 }
 
-template <MoveType moveType>
-void generateMoves(MoveList& moveList, const Position& position) {
+template <Piece piece, bool legal>
+inline void addCaptures(MoveList& moveList, const CheckInfo& checkInfo, Bitboard attackers, const Square to) {
+    while (attackers) {
+        Square from = attackers.popLsb();
+        if (isPinnedMoveAllowed<legal>(checkInfo, from, to))
+            moveList.addMove(from, to, piece, true);
+    }
+}
+
+// non quiet moves in MVV/LVA order without scoring: promotions, then each victim from queens down to pawns
+// captured by the least valuable attackers first
+template <Color color, bool legal>
+void generateNonQuietMoves(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
+    constexpr Color opponent = ~color;
+    constexpr Bitboard promotionRank = (color == Color::White) ? Bitboard::RankBitboard(6) : Bitboard::RankBitboard(1);
+    constexpr Piece pawn = getPiece(PieceType::Pawn, color);
+    constexpr Piece knight = getPiece(PieceType::Knight, color);
+    constexpr Piece bishop = getPiece(PieceType::Bishop, color);
+    constexpr Piece rook = getPiece(PieceType::Rook, color);
+    constexpr Piece queen = getPiece(PieceType::Queen, color);
+    constexpr Piece king = getPiece(PieceType::King, color);
+
+    // in double check only the king can move
+    const bool onlyKing = legal && checkInfo.checkers.several();
+    const Bitboard targetMask = legal ? checkInfo.evasionMask : ~Bitboard(0ULL);
+    const Bitboard occupied = position.getOccupied();
+    const Bitboard pawns = position.getPieces<pawn>() & ~promotionRank;
+    const Bitboard knights = legal ? position.getPieces<knight>() & ~checkInfo.pinned : position.getPieces<knight>();
+
+    if (!onlyKing) generatePromotions<color, legal>(moveList, position, checkInfo);
+
+    for (std::int8_t victimType = static_cast<std::int8_t>(PieceType::Queen); victimType >= static_cast<std::int8_t>(PieceType::Pawn); victimType--) {
+        Bitboard victims = position.getPieces(opponent, static_cast<PieceType>(victimType));
+
+        while (victims) {
+            const Square to = victims.popLsb();
+
+            if (!onlyKing && (targetMask & to)) {
+                addCaptures<pawn, legal>(moveList, checkInfo, getPawnAttacks(to, opponent) & pawns, to);
+                addCaptures<knight, legal>(moveList, checkInfo, getKnightAttacks(to) & knights, to);
+                addCaptures<bishop, legal>(moveList, checkInfo, getBishopAttacks(to, occupied) & position.getPieces<bishop>(), to);
+                addCaptures<rook, legal>(moveList, checkInfo, getRookAttacks(to, occupied) & position.getPieces<rook>(), to);
+                addCaptures<queen, legal>(moveList, checkInfo, getQueenAttacks(to, occupied) & position.getPieces<queen>(), to);
+            }
+
+            if (getKingAttacks(to) & position.getPieces<king>()) {
+                Move move {Square{position.getPieces<king>().lsb()}, to, king, true, false, false, false};
+                if (!legal || position.isLegal(move, checkInfo))
+                    moveList.addMove(move);
+            }
+        }
+    }
 
-    if (position.sideToMove == Color::White) {
-        generatePawnMoves<moveType, Color::White>(moveList, position);
-        generatePieceMoves<moveType, Piece::WhiteKnight>(moveList, position);
-        generatePieceMoves<moveType, Piece::WhiteBishop>(moveList, position);
-        generatePieceMoves<moveType, Piece::WhiteRook>(moveList, position);
-        generatePieceMoves<moveType, Piece::WhiteQueen>(moveList, position);
-        generatePieceMoves<moveType, Piece::WhiteKing>(moveList, position);
-        if constexpr (moveType == MoveType::QuietMoves || moveType == MoveType::AllMoves)
-            generateCastlingMoves<Color::White>(moveList, position);
+    if (!onlyKing) generateEnPassant<color, legal>(moveList, position, checkInfo);
+}
+
+template <MoveType moveType, Color color, bool legal>
+void generateMoves(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
+    if constexpr (moveType == MoveType::NonQuietMoves) {
+        generateNonQuietMoves<color, legal>(moveList, position, checkInfo);
+        return;
     }
-    else {
-        generatePawnMoves<moveType, Color::Black>(moveList, position);
-        generatePieceMoves<moveType, Piece::BlackKnight>(moveList, position);
-        generatePieceMoves<moveType, Piece::BlackBishop>(moveList, position);
-        generatePieceMoves<moveType, Piece::BlackRook>(moveList, position);
-        generatePieceMoves<moveType, Piece::BlackQueen>(moveList, position);
-        generatePieceMoves<moveType, Piece::BlackKing>(moveList, position);
-        if constexpr (moveType == MoveType::QuietMoves || moveType == MoveType::AllMoves)
-            generateCastlingMoves<Color::Black>(moveList, position);
+
+    constexpr Piece knight = getPiece(PieceType::Knight, color);
+    constexpr Piece bishop = getPiece(PieceType::Bishop, color);
+    constexpr Piece rook = getPiece(PieceType::Rook, color);
+    constexpr Piece queen = getPiece(PieceType::Queen, color);
+    constexpr Piece king = getPiece(PieceType::King, color);
+
+    // in double check only the king can move
+    if (!legal || !checkInfo.checkers.several()) {
+        generatePawnMoves<moveType, color, legal>(moveList, position, checkInfo);
+        generatePieceMoves<moveType, knight, legal>(moveList, position, checkInfo);
+        generatePieceMoves<moveType, bishop, legal>(moveList, position, checkInfo);
+        generatePieceMoves<moveType, rook, legal>(moveList, position, checkInfo);
+        generatePieceMoves<moveType, queen, legal>(moveList, position, checkInfo);
     }
+    generatePieceMoves<moveType, king, legal>(moveList, position, checkInfo);
+    if constexpr (moveType == MoveType::QuietMoves || moveType == MoveType::AllMoves)
+        if (!legal || !checkInfo.checkers)
+            generateCastlingMoves<color>(moveList, position);
+}
+
+// pseudo legal moves, leaving our king in check has to be tested after the move is made
+template <MoveType moveType>
+void generateMoves(MoveList& moveList, const Position& position) {
+    constexpr CheckInfo noCheckInfo {};
+    if (position.sideToMove == Color::White) generateMoves<moveType, Color::White, false>(moveList, position, noCheckInfo);
+    else                                     generateMoves<moveType, Color::Black, false>(moveList, position, noCheckInfo);
+}
+
+// legal moves, using the check and pin information of the position
+template <MoveType moveType>
+void generateLegalMoves(MoveList& moveList, const Position& position, const CheckInfo& checkInfo) {
+    if (position.sideToMove == Color::White) generateMoves<moveType, Color::White, true>(moveList, position, checkInfo);
+    else                                     generateMoves<moveType, Color::Black, true>(moveList, position, checkInfo);
+}
+
+template <MoveType moveType>
+void generateLegalMoves(MoveList& moveList, const Position& position) {
+    generateLegalMoves<moveType>(moveList, position, position.computeCheckInfo());
 }
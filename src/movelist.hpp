@@ -2,25 +2,32 @@
 
 #include "move.hpp"
 #include "piece.hpp"
+#include "utils.hpp"
 
 #include <cstdint>
 #include <iostream>
+#include <utility>
 
-struct MoveExt {
-    Move move;
-    std::int32_t score = INT32_MIN;
-};
+static_assert(sizeof(Move) == sizeof(std::uint32_t), "moves are loaded as 32 bit SIMD lanes");
+
+constexpr std::uint32_t maxMoveCount = 256;
+constexpr std::uint32_t moveScorePadding = 8;      // vectorized scans may read one SIMD block past the last move
 
+// moves and their ordering scores are stored in separate arrays, so that the scores can be scanned with SIMD.
+// The list does not own its storage: search lists are slices of the thread move arena, other lists use LocalMoveList
 class MoveList
 {
 private:
-    MoveExt moves[256];
+    Move* moves;
+    std::int32_t* scores;
     std::uint32_t size;
 
 public:
-    MoveList() : size(0) {};
+    MoveList(Move* moveStorage, std::int32_t* scoreStorage) : moves(moveStorage), scores(scoreStorage), size(0) {};
+    MoveList(const MoveList&) = delete;
+    MoveList& operator=(const MoveList&) = delete;
 
-    void addMove(const Move move) { moves[size++] = {move, INT32_MIN}; }
+    void addMove(const Move move) { moves[size++] = move; }
     void addMove(const Square from, const Square to, const Piece piece) { addMove(Move(from, to, piece, false, false, false, false)); }
     void addMove(const Square from, const Square to, const Piece piece, const bool capture) { addMove(Move(from, to, piece, capture, false, false, false)); }
 
@@ -54,11 +61,21 @@ public:
 
     void clear() { size = 0; }
     std::uint32_t getSize() const { return size; }
-    MoveExt& operator[](const std::uint32_t index) { return moves[index]; }
+    Move& operator[](const std::uint32_t index) { return moves[index]; }
+    std::int32_t& getScore(const std::uint32_t index) { return scores[index]; }
+    Move* getMoves() { return moves; }
+    const Move* getMoves() const { return moves; }
+    std::int32_t* getScores() { return scores; }
+
+    void swap(const std::uint32_t first, const std::uint32_t second) {
+        std::swap(moves[first], moves[second]);
+        std::swap(scores[first], scores[second]);
+    }
 
-    bool filter(const Move move) {
-        for (std::uint32_t i = 0; i < size; ++i) {
-            if (moves[i].move == move) {
+    // removes the first occurrence of the move at or after index start, the last move takes its place
+    bool filter(const Move move, const std::uint32_t start = 0) {
+        for (std::uint32_t i = start; i < size; ++i) {
+            if (moves[i] == move) {
                 moves[i] = moves[--size];
                 return true;
             }
@@ -68,8 +85,29 @@ public:
 
     friend std::ostream& operator<<(std::ostream& output, const MoveList& moveList) {
         for (std::uint32_t i = 0; i < moveList.size; ++i) {
-            output << moveList.moves[i].move << ", " << moveList.moves[i].score << "\n";
+            output << moveList.moves[i] << ", " << moveList.scores[i] << "\n";
         }
         return output;
     }
 };
+
+// move list with its own storage, for the short lived lists outside of the search tree
+class LocalMoveList : public MoveList
+{
+private:
+    alignas(32) Move moveStorage[maxMoveCount];
+    alignas(32) std::int32_t scoreStorage[maxMoveCount + moveScorePadding];
+
+public:
+    LocalMoveList() : MoveList(moveStorage, scoreStorage) {};
+};
+
+// Move storage of a search thread. The list of a node starts where the list of its parent currently ends, so the
+// lists of the current line are packed one after the other and sized by their actual move counts
+struct MoveArena {
+    static constexpr std::uint32_t capacity = maxMoveCount * maxSearchDepth;
+
+    alignas(32) Move moves[capacity];
+    alignas(32) std::int32_t scores[capacity + moveScorePadding];
+    MoveList* top = nullptr;        // list of the deepest node of the current line
+};
@@ -1,53 +1,57 @@
 #include "movesorter.hpp"
 
+#include "bench.hpp"
+#include "inputoutput.hpp"
 #include "movegen.hpp"
 #include "piece.hpp"
 #include "see.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 bool MoveSorter::nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet) {
     std::uint32_t bestIndex = MoveSorter::InvalidIndex;
 
     switch (currentStage) {
         case MoveSorterStage::TTMove:
             currentStage = MoveSorterStage::GeneratingNonQuiets;
-            if (ttMove.isValid() && (!ttMove.isQuiet() || !skipQuiet)) {
+            if (ttMove.isValid() && (!ttMove.isQuiet() || !skipQuiet) && position.isPseudoLegal(ttMove) && position.isLegal(ttMove, checkInfo)) {
                 outMove = ttMove;
                 return true;
             }
             [[fallthrough]];
         case MoveSorterStage::GeneratingNonQuiets:
-            generateMoves<MoveType::NonQuietMoves>(moveList, position);
-            moveList.filter(ttMove);
-            scoreNonQuiets();
+            generateLegalMoves<MoveType::NonQuietMoves>(moveList, position, checkInfo);
 
             currentStage = MoveSorterStage::GoodNonQuiets;
             [[fallthrough]];
         case MoveSorterStage::GoodNonQuiets:
-            bestIndex = nextSortedIndex(currentIndex, moveList.getSize());
+            // non quiets are generated in MVV/LVA order, SEE only runs on the move about to be returned
+            while (currentIndex < moveList.getSize()) {
+                const Move move = moveList[currentIndex++];
+                if (move == ttMove) continue;
 
-            // no more good non quiets
-            if (moveList[bestIndex].score < GoodNonQuietScore) {
-                badNonQuietsIndex = currentIndex;
-            }
-            // good non-quiet
-            else {
-                outMove = pop(bestIndex);
-                return true;
-            }
+                if (staticExchangeEvaluation(position, move, MoveSorter::GoodNonQuietThreshold)) {
+                    outMove = move;
+                    return true;
+                }
 
-            [[fallthrough]];
-        case MoveSorterStage::GeneratingQuiets:
-            quietMoveIndex = moveList.getSize();
-            if (!skipQuiet) {
-                generateMoves<MoveType::QuietMoves>(moveList, position);
-                moveList.filter(ttMove);
+                // bad non quiets are kept in order at the front of the list, over the moves already returned
+                moveList[badNonQuietsEnd++] = move;
             }
 
             [[fallthrough]];
         case MoveSorterStage::Killer1:
+            // killers and the counter move are validated on the position, a cutoff from one of them skips quiet generation
             if (!skipQuiet) {
                 currentStage = MoveSorterStage::Killer2;
-                if (moveList.filter(killerMoves.killer1)) {
+                if (isQuietRefutation(killerMoves.killer1)) {
                     outMove = killerMoves.killer1;
                     return true;
                 }
@@ -57,7 +61,7 @@ bool MoveSorter::nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet) {
         case MoveSorterStage::Killer2:
             if (!skipQuiet) {
                 currentStage = MoveSorterStage::CounterMove;
-                if (moveList.filter(killerMoves.killer2)) {
+                if (isQuietRefutation(killerMoves.killer2)) {
                     outMove = killerMoves.killer2;
                     return true;
                 }
@@ -66,13 +70,27 @@ bool MoveSorter::nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet) {
             [[fallthrough]];
         case MoveSorterStage::CounterMove:
             if (!skipQuiet) {
-                currentStage = MoveSorterStage::OrderingQuiets;
-                if (moveList.filter(counterMove)) {
+                currentStage = MoveSorterStage::GeneratingQuiets;
+                if (counterMove != killerMoves.killer1 && counterMove != killerMoves.killer2 && isQuietRefutation(counterMove)) {
                     outMove = counterMove;
                     return true;
                 }
             }
 
+            [[fallthrough]];
+        case MoveSorterStage::GeneratingQuiets:
+            quietMoveIndex = moveList.getSize();
+            currentIndex = quietMoveIndex;
+            if (!skipQuiet) {
+                generateLegalMoves<MoveType::QuietMoves>(moveList, position, checkInfo);
+                // only the quiet range is searched, the walked non quiet range still holds a non quiet TT move
+                moveList.filter(ttMove, quietMoveIndex);
+                moveList.filter(killerMoves.killer1, quietMoveIndex);
+                moveList.filter(killerMoves.killer2, quietMoveIndex);
+                moveList.filter(counterMove, quietMoveIndex);
+                currentStage = MoveSorterStage::OrderingQuiets;
+            }
+
             [[fallthrough]];
         case MoveSorterStage::OrderingQuiets:
             if (!skipQuiet) {
@@ -89,13 +107,12 @@ bool MoveSorter::nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet) {
             }
             else {
                 currentStage = MoveSorterStage::BadNonQuiets;
-                currentIndex = badNonQuietsIndex;
+                currentIndex = 0;
             }
             [[fallthrough]];
         case MoveSorterStage::BadNonQuiets:
-            if (!skipBadNonQuiet && currentIndex < quietMoveIndex) {
-                bestIndex = nextSortedIndex(currentIndex, quietMoveIndex);
-                outMove = pop(bestIndex);
+            if (!skipBadNonQuiet && currentIndex < badNonQuietsEnd) {
+                outMove = moveList[currentIndex++];
                 return true;
             }
             else {
@@ -105,35 +122,146 @@ bool MoveSorter::nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet) {
     return false;
 }
 
-void MoveSorter::scoreNonQuiets() {
-    for (std::uint32_t index = currentIndex; index < moveList.getSize(); ++index) {
-        PieceType attacker = getPieceType(moveList[index].move.getPiece());
-        PieceType victim = getPieceType(position.pieceAt(moveList[index].move.getTo()));
+// quiet move from the killer or counter move tables that is legal in this position and was not already tried as the TT move
+bool MoveSorter::isQuietRefutation(Move move) const {
+    return move.isValid() && move != ttMove && move.isQuiet() && position.isPseudoLegal(move) && position.isLegal(move, checkInfo);
+}
 
-        moveList[index].score = 6 * static_cast<std::int32_t>(victim) - static_cast<std::int32_t>(attacker);
+void MoveSorter::scoreQuiets() {
+    const std::int32_t* history = quietHistoryTable[static_cast<std::uint8_t>(position.sideToMove)][0].data();
+    const Move* moves = moveList.getMoves();
+    std::int32_t* scores = moveList.getScores();
+    std::uint32_t index = quietMoveIndex;
 
-        if (staticExchangeEvaluation(position, moveList[index].move, MoveSorter::GoodNonQuietThreshold)) {
-            moveList[index].score += MoveSorter::GoodNonQuietScoreBonus;
-        }
+#if defined(__AVX2__)
+    // history scores are gathered 8 moves at a time, indexed by from * 64 + to
+    const __m256i squareMask = _mm256_set1_epi32(0x3f);
+    for (; index + 8 <= moveList.getSize(); index += 8) {
+        const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(moves + index));
+        const __m256i historyIndex = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(values, squareMask), 6),
+                                                     _mm256_and_si256(_mm256_srli_epi32(values, 6), squareMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(scores + index), _mm256_i32gather_epi32(history, historyIndex, 4));
     }
-}
+#endif
 
-void MoveSorter::scoreQuiets() {
-    for (std::uint32_t index = quietMoveIndex; index < moveList.getSize(); ++index) {
-        const Move& move = moveList[index].move;
-        moveList[index].score = quietHistoryTable[static_cast<std::uint8_t>(position.sideToMove)][move.getFrom().index()][move.getTo().index()];
+    for (; index < moveList.getSize(); ++index) {
+        scores[index] = history[moves[index].getFrom().index() * 64 + moves[index].getTo().index()];
     }
 }
 
 Move MoveSorter::pop(std::uint32_t index) {
-    std::swap<MoveExt>(moveList[index], moveList[currentIndex]);
-    return moveList[currentIndex++].move;
+    moveList.swap(index, currentIndex);
+    return moveList[currentIndex++];
 }
 
+// index of the first best score in [start, end)
 std::uint32_t MoveSorter::nextSortedIndex(std::uint32_t start, std::uint32_t end) {
+    const std::int32_t* scores = moveList.getScores();
+
+#if defined(__AVX2__)
+    if (end - start >= 8) {
+        // maximum over blocks of 8 scores, the last block overlaps the previous ones
+        __m256i best = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scores + start));
+        for (std::uint32_t index = start + 8; index + 8 <= end; index += 8) {
+            best = _mm256_max_epi32(best, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scores + index)));
+        }
+        best = _mm256_max_epi32(best, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scores + end - 8)));
+
+        __m128i best128 = _mm_max_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+        best128 = _mm_max_epi32(best128, _mm_shuffle_epi32(best128, 0x4E));
+        best128 = _mm_max_epi32(best128, _mm_shuffle_epi32(best128, 0xB1));
+
+        // the first block holding the maximum is found before any padding score past the end
+        const __m256i target = _mm256_set1_epi32(_mm_cvtsi128_si32(best128));
+        for (std::uint32_t index = start; ; index += 8) {
+            const __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(scores + index)), target);
+            const std::uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+            if (mask) return index + std::countr_zero(mask);
+        }
+    }
+#elif defined(__SSE4_1__)
+    if (end - start >= 4) {
+        __m128i best = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + start));
+        for (std::uint32_t index = start + 4; index + 4 <= end; index += 4) {
+            best = _mm_max_epi32(best, _mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + index)));
+        }
+        best = _mm_max_epi32(best, _mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + end - 4)));
+        best = _mm_max_epi32(best, _mm_shuffle_epi32(best, 0x4E));
+        best = _mm_max_epi32(best, _mm_shuffle_epi32(best, 0xB1));
+
+        const __m128i target = _mm_shuffle_epi32(best, 0);
+        for (std::uint32_t index = start; ; index += 4) {
+            const std::uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + index)), target)));
+            if (mask) return index + std::countr_zero(mask);
+        }
+    }
+#endif
+
     std::uint32_t bestIndex = start;
     for (std::uint32_t index = start + 1; index < end; index++) {
-        if (moveList[index].score > moveList[bestIndex].score) bestIndex = index;
+        if (scores[index] > scores[bestIndex]) bestIndex = index;
     }
     return bestIndex;
 }
+
+// the sorter has to return exactly the legal moves, once each, whatever TT, killer and counter moves it is given.
+// Checked on the bench positions and their children, with each legal non quiet move as TT move and quiet moves
+// as killers and counter move
+bool testMoveSorter() {
+    auto moveArena = std::make_unique<MoveArena>();
+    auto historyTable = std::make_unique<MoveHistoryTable>();
+    std::uint64_t caseCount = 0, failureCount = 0;
+
+    auto testPosition = [&](const Position& position) {
+        LocalMoveList legalMoves;
+        generateLegalMoves<MoveType::AllMoves>(legalMoves, position);
+        std::vector<std::uint32_t> expected, quiets;
+        for (std::uint32_t i = 0; i < legalMoves.getSize(); i++) {
+            expected.push_back(legalMoves[i].getValue());
+            if (legalMoves[i].isQuiet()) quiets.push_back(legalMoves[i].getValue());
+        }
+        std::sort(expected.begin(), expected.end());
+
+        KillerMoves killerMoves;
+        Move counterMove = Move::Invalid();
+        if (quiets.size() > 0) killerMoves.killer1 = quiets[0];
+        if (quiets.size() > 1) killerMoves.killer2 = quiets[1];
+        if (quiets.size() > 2) counterMove = quiets[2];
+
+        std::vector<Move> ttMoves {Move::Invalid()};
+        for (std::uint32_t i = 0; i < legalMoves.getSize(); i++) {
+            if (!legalMoves[i].isQuiet()) ttMoves.push_back(legalMoves[i]);
+        }
+
+        for (const Move ttMove : ttMoves) {
+            MoveSorter moveSorter {*moveArena, position, ttMove, *historyTable, killerMoves, counterMove};
+            std::vector<std::uint32_t> returned;
+            Move move;
+            while (moveSorter.nextMove(move, false, false)) returned.push_back(move.getValue());
+            std::sort(returned.begin(), returned.end());
+
+            caseCount++;
+            if (returned != expected) {
+                failureCount++;
+                writeLine("info string error: move sorter returned ", returned.size(), " moves instead of ", expected.size(), " with TT move ", ttMove);
+            }
+        }
+    };
+
+    for (const std::string& fen : benchFens) {
+        Position position;
+        position.loadFromFen(fen);
+        testPosition(position);
+
+        LocalMoveList moveList;
+        generateLegalMoves<MoveType::AllMoves>(moveList, position);
+        for (std::uint32_t i = 0; i < moveList.getSize(); i++) {
+            Position child = position;
+            child.makeMove(moveList[i]);
+            testPosition(child);
+        }
+    }
+
+    writeLine("Move sorter test: ", caseCount, " cases, ", failureCount, " failures");
+    return failureCount == 0;
+}
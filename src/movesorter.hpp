@@ -11,10 +11,10 @@ enum class MoveSorterStage : std::uint8_t {
     TTMove,
     GeneratingNonQuiets,
     GoodNonQuiets,
-    GeneratingQuiets,
     Killer1,
     Killer2,
     CounterMove,
+    GeneratingQuiets,
     OrderingQuiets,
     Quiets,
     BadNonQuiets,
@@ -36,8 +36,11 @@ using CounterMoveTable = std::array<std::array<Move, 64>, 12>;
 
 class MoveSorter {
 private:
+    MoveArena& moveArena;
+    MoveList* const parentList;
     MoveList moveList;
     const Position& position;
+    const CheckInfo checkInfo;
 
     const Move ttMove;
     const MoveHistoryTable& quietHistoryTable;
@@ -47,10 +50,10 @@ private:
     MoveSorterStage currentStage = MoveSorterStage::TTMove;
 
     std::uint32_t currentIndex      = 0;
-    std::uint32_t badNonQuietsIndex = 0;
+    std::uint32_t badNonQuietsEnd   = 0;
     std::uint32_t quietMoveIndex    = 0;
 
-    void scoreNonQuiets();
+    bool isQuietRefutation(Move move) const;
     void scoreQuiets();
 
     std::uint32_t nextSortedIndex(std::uint32_t start, std::uint32_t end) ;
@@ -59,12 +62,18 @@ private:
     constexpr static std::int32_t GoodNonQuietThreshold = -103;
     constexpr static std::uint32_t InvalidIndex = UINT32_MAX;
 
-    constexpr static std::int32_t GoodNonQuietScoreBonus = 50000;
-    constexpr static std::int32_t GoodNonQuietScore = 40000;
-
 
 public:
     bool nextMove(Move& outMove, bool skipQuiet, bool skipBadNonQuiet);
 
-    MoveSorter(const Position& pos, const Move& move, const MoveHistoryTable& historyTable, const KillerMoves& killers, const Move& counter) : position{pos}, ttMove{move}, quietHistoryTable{historyTable}, killerMoves{killers}, counterMove{counter} {};
-};
\ No newline at end of file
+    // the move list is taken from the arena after the list of the parent node, and given back on destruction
+    MoveSorter(MoveArena& arena, const Position& pos, const Move& move, const MoveHistoryTable& historyTable, const KillerMoves& killers, const Move& counter) :
+        moveArena{arena}, parentList{arena.top},
+        moveList{arena.top ? arena.top->getMoves() + arena.top->getSize() : arena.moves, arena.top ? arena.top->getScores() + arena.top->getSize() : arena.scores},
+        position{pos}, checkInfo{pos.computeCheckInfo()}, ttMove{move}, quietHistoryTable{historyTable}, killerMoves{killers}, counterMove{counter} { arena.top = &moveList; };
+    ~MoveSorter() { moveArena.top = parentList; };
+    MoveSorter(const MoveSorter&) = delete;
+    MoveSorter& operator=(const MoveSorter&) = delete;
+};
+
+bool testMoveSorter();
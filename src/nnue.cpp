@@ -0,0 +1,229 @@
+#include "nnue.hpp"
+
+#include "inputoutput.hpp"
+#include "rng.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+NnueNetwork nnueNetwork;
+NnueNetworkSource nnueNetworkSource = NnueNetworkSource::None;
+
+bool loadNnueNetwork(const std::string& fileName) {
+    std::ifstream file {fileName, std::ios::binary};
+    if (!file) {
+        writeLine("info string error: cannot open EvalFile ", fileName);
+        return false;
+    }
+
+    // weights are stored field by field without padding, they are read aside so that a bad file keeps the current network
+    std::unique_ptr<NnueNetwork> network = std::make_unique<NnueNetwork>();
+    file.read(reinterpret_cast<char*>(network->featureWeights), sizeof(network->featureWeights));
+    file.read(reinterpret_cast<char*>(network->featureBias), sizeof(network->featureBias));
+    file.read(reinterpret_cast<char*>(network->outputWeights), sizeof(network->outputWeights));
+    file.read(reinterpret_cast<char*>(&network->outputBias), sizeof(network->outputBias));
+
+    if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+        writeLine("info string error: EvalFile ", fileName, " does not match the network architecture");
+        return false;
+    }
+
+    nnueNetwork = *network;
+    nnueNetworkSource = NnueNetworkSource::File;
+    writeLine("info string NNUE network loaded from ", fileName);
+    return true;
+}
+
+void loadRandomNnueNetwork(std::uint64_t seed) {
+    PRNG rng {seed};
+    auto randomWeight = [&rng](std::int32_t range) { return static_cast<std::int16_t>(static_cast<std::int32_t>(rng.next() % (2 * range + 1)) - range); };
+
+    for (auto& featureWeights : nnueNetwork.featureWeights) {
+        for (std::int16_t& weight : featureWeights) weight = randomWeight(32);
+    }
+    for (std::int16_t& bias : nnueNetwork.featureBias) bias = randomWeight(64);
+    for (std::int16_t& weight : nnueNetwork.outputWeights) weight = randomWeight(64);
+    nnueNetwork.outputBias = 0;
+
+    nnueNetworkSource = NnueNetworkSource::Random;
+}
+
+void unloadNnueNetwork() {
+    nnueNetworkSource = NnueNetworkSource::None;
+}
+
+NnueNetworkSource getNnueNetworkSource() {
+    return nnueNetworkSource;
+}
+
+static constexpr std::uint32_t getKingBucket(std::uint8_t orientedKingSquare) {
+    const std::uint32_t sideBucket = (orientedKingSquare % 8 < 4) ? 0 : 1;
+    return (orientedKingSquare < 16) ? sideBucket : 2 + sideBucket;
+}
+
+static constexpr std::uint8_t orientSquare(Square square, Color perspective) {
+    return (perspective == Color::White) ? square.index() : square.flipIndex();
+}
+
+static constexpr std::uint32_t getFeatureIndex(Piece piece, Square square, Square kingSquare, Color perspective) {
+    const std::uint32_t relativePiece = ((getPieceColor(piece) == perspective) ? 0 : 6) + static_cast<std::uint32_t>(getPieceType(piece));
+    return (getKingBucket(orientSquare(kingSquare, perspective)) * 12 + relativePiece) * 64 + orientSquare(square, perspective);
+}
+
+// accumulator kernels, output = input + sum(added rows) - sum(removed rows)
+static void updateRows(const std::int16_t* input, std::int16_t* output, const std::int16_t* const* added, std::uint32_t addedCount, const std::int16_t* const* removed, std::uint32_t removedCount) {
+#if defined(__AVX2__)
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i += 16) {
+        __m256i sum = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + i));
+        for (std::uint32_t j = 0; j < addedCount; j++)   sum = _mm256_add_epi16(sum, _mm256_load_si256(reinterpret_cast<const __m256i*>(added[j] + i)));
+        for (std::uint32_t j = 0; j < removedCount; j++) sum = _mm256_sub_epi16(sum, _mm256_load_si256(reinterpret_cast<const __m256i*>(removed[j] + i)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(output + i), sum);
+    }
+#elif defined(__SSE4_1__)
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i += 8) {
+        __m128i sum = _mm_load_si128(reinterpret_cast<const __m128i*>(input + i));
+        for (std::uint32_t j = 0; j < addedCount; j++)   sum = _mm_add_epi16(sum, _mm_load_si128(reinterpret_cast<const __m128i*>(added[j] + i)));
+        for (std::uint32_t j = 0; j < removedCount; j++) sum = _mm_sub_epi16(sum, _mm_load_si128(reinterpret_cast<const __m128i*>(removed[j] + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(output + i), sum);
+    }
+#else
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i++) {
+        std::int16_t sum = input[i];
+        for (std::uint32_t j = 0; j < addedCount; j++)   sum += added[j][i];
+        for (std::uint32_t j = 0; j < removedCount; j++) sum -= removed[j][i];
+        output[i] = sum;
+    }
+#endif
+}
+
+// sum of clipped ReLU(accumulator) * weights
+static std::int32_t outputDotProduct(const std::int16_t* accumulator, const std::int16_t* weights) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ceiling = _mm256_set1_epi16(nnueQuantA);
+    __m256i sum = _mm256_setzero_si256();
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i += 16) {
+        __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+        value = _mm256_min_epi16(_mm256_max_epi16(value, zero), ceiling);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i))));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+    return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE4_1__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ceiling = _mm_set1_epi16(nnueQuantA);
+    __m128i sum = _mm_setzero_si128();
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i += 8) {
+        __m128i value = _mm_load_si128(reinterpret_cast<const __m128i*>(accumulator + i));
+        value = _mm_min_epi16(_mm_max_epi16(value, zero), ceiling);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(value, _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    std::int32_t sum = 0;
+    for (std::uint32_t i = 0; i < nnueHiddenSize; i++) {
+        sum += std::clamp<std::int32_t>(accumulator[i], 0, nnueQuantA) * weights[i];
+    }
+    return sum;
+#endif
+}
+
+DirtyPieces getDirtyPieces(const Position& position, Move move) {
+    DirtyPieces dirtyPieces = getNullDirtyPieces();
+
+    const Square from = move.getFrom();
+    const Square to = move.getTo();
+    const Piece piece = move.getPiece();
+    const Color color = getPieceColor(piece);
+
+    auto addChange = [&dirtyPieces](Piece changedPiece, Square changeFrom, Square changeTo) {
+        dirtyPieces.pieces[dirtyPieces.count] = changedPiece;
+        dirtyPieces.from[dirtyPieces.count] = changeFrom;
+        dirtyPieces.to[dirtyPieces.count] = changeTo;
+        dirtyPieces.count++;
+    };
+
+    if (move.isPromotion()) {
+        addChange(piece, from, Square::None);
+        addChange(move.getPromotionPiece(), Square::None, to);
+    }
+    else {
+        addChange(piece, from, to);
+    }
+
+    if (move.isCastling()) {
+        addChange(getPiece(PieceType::Rook, color), rookFromCastling(to), rookToCastling(to));
+    }
+    else if (move.isEnpassant()) {
+        addChange(getPiece(PieceType::Pawn, ~color), Square(from.rank(), to.file()), Square::None);
+    }
+    else if (move.isCapture()) {
+        addChange(position.pieceAt(to), to, Square::None);
+    }
+
+    if (getPieceType(piece) == PieceType::King) {
+        dirtyPieces.refresh[static_cast<std::uint8_t>(color)] = getKingBucket(orientSquare(from, color)) != getKingBucket(orientSquare(to, color));
+    }
+
+    return dirtyPieces;
+}
+
+DirtyPieces getNullDirtyPieces() {
+    return DirtyPieces {0, {Piece::None, Piece::None, Piece::None}, {}, {}, {false, false}};
+}
+
+void refreshAccumulator(Accumulator& accumulator, const Position& position, Color perspective) {
+    const Square kingSquare = position.getPieces(perspective, PieceType::King).lsb();
+    std::int16_t* values = accumulator.values[static_cast<std::uint8_t>(perspective)];
+
+    std::copy(std::begin(nnueNetwork.featureBias), std::end(nnueNetwork.featureBias), values);
+
+    Bitboard occupied = position.getOccupied();
+    while (occupied) {
+        const Square square = occupied.popLsb();
+        const std::int16_t* row = nnueNetwork.featureWeights[getFeatureIndex(position.pieceAt(square), square, kingSquare, perspective)];
+        updateRows(values, values, &row, 1, nullptr, 0);
+    }
+
+    accumulator.computed[static_cast<std::uint8_t>(perspective)] = true;
+}
+
+void updateAccumulator(const Accumulator& previous, Accumulator& accumulator, const DirtyPieces& dirtyPieces, Square kingSquare, Color perspective) {
+    const std::int16_t* added[3];
+    const std::int16_t* removed[3];
+    std::uint32_t addedCount = 0, removedCount = 0;
+
+    for (std::uint8_t i = 0; i < dirtyPieces.count; i++) {
+        if (dirtyPieces.from[i] != Square::None) removed[removedCount++] = nnueNetwork.featureWeights[getFeatureIndex(dirtyPieces.pieces[i], dirtyPieces.from[i], kingSquare, perspective)];
+        if (dirtyPieces.to[i] != Square::None)   added[addedCount++] = nnueNetwork.featureWeights[getFeatureIndex(dirtyPieces.pieces[i], dirtyPieces.to[i], kingSquare, perspective)];
+    }
+
+    const std::uint8_t index = static_cast<std::uint8_t>(perspective);
+    updateRows(previous.values[index], accumulator.values[index], added, addedCount, removed, removedCount);
+    accumulator.computed[index] = true;
+}
+
+Score evaluateNnue(const Accumulator& accumulator, Color sideToMove) {
+    const std::int32_t output = outputDotProduct(accumulator.values[static_cast<std::uint8_t>(sideToMove)], nnueNetwork.outputWeights)
+                              + outputDotProduct(accumulator.values[static_cast<std::uint8_t>(~sideToMove)], nnueNetwork.outputWeights + nnueHiddenSize)
+                              + nnueNetwork.outputBias;
+
+    const std::int32_t score = static_cast<std::int32_t>(static_cast<std::int64_t>(output) * nnueScale / (nnueQuantA * nnueQuantB));
+    return static_cast<Score>(std::clamp<std::int32_t>(score, -checkmateInMaxPly + 1, checkmateInMaxPly - 1));
+}
+
+Score evaluateNnue(const Position& position) {
+    Accumulator accumulator;
+    refreshAccumulator(accumulator, position, Color::White);
+    refreshAccumulator(accumulator, position, Color::Black);
+    return evaluateNnue(accumulator, position.sideToMove);
+}
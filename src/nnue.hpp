@@ -0,0 +1,55 @@
+#pragma once
+
+#include "move.hpp"
+#include "position.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <string>
+
+// HalfKA style network: (4 king buckets x 12 pieces x 64 squares -> 256) x 2 perspectives -> 1
+constexpr std::uint32_t nnueKingBuckets = 4;
+constexpr std::uint32_t nnueInputSize   = nnueKingBuckets * 12 * 64;
+constexpr std::uint32_t nnueHiddenSize  = 256;
+
+constexpr std::int32_t nnueQuantA = 255;   // accumulator quantization, also the clipped ReLU ceiling
+constexpr std::int32_t nnueQuantB = 64;    // output weights quantization
+constexpr std::int32_t nnueScale  = 400;   // network output to centipawns
+
+struct alignas(64) NnueNetwork {
+    std::int16_t featureWeights[nnueInputSize][nnueHiddenSize];
+    std::int16_t featureBias[nnueHiddenSize];
+    std::int16_t outputWeights[2 * nnueHiddenSize];   // side to move half first, then the other side
+    std::int32_t outputBias;
+};
+
+struct alignas(64) Accumulator {
+    std::int16_t values[2][nnueHiddenSize];   // indexed by perspective color
+    bool computed[2];
+};
+
+struct DirtyPieces {   // piece changes made by the move leading to a node, used to update the accumulators of the child
+    std::uint8_t count;
+    Piece pieces[3];
+    Square from[3];         // Square::None for a piece added to the board
+    Square to[3];           // Square::None for a piece removed from the board
+    bool refresh[2];        // the king of this perspective changed bucket, the accumulator has to be rebuilt
+};
+
+enum class NnueNetworkSource : std::uint8_t {
+    None,
+    File,
+    Random
+};
+
+bool loadNnueNetwork(const std::string& fileName);       // load quantized weights in NnueNetwork order from a raw little endian file, the current network is kept on failure
+void loadRandomNnueNetwork(std::uint64_t seed);         // deterministic random weights, only meaningful to measure speed
+void unloadNnueNetwork();
+NnueNetworkSource getNnueNetworkSource();
+
+DirtyPieces getDirtyPieces(const Position& position, Move move);     // computed on the position before the move
+DirtyPieces getNullDirtyPieces();
+void refreshAccumulator(Accumulator& accumulator, const Position& position, Color perspective);
+void updateAccumulator(const Accumulator& previous, Accumulator& accumulator, const DirtyPieces& dirtyPieces, Square kingSquare, Color perspective);
+Score evaluateNnue(const Accumulator& accumulator, Color sideToMove);
+Score evaluateNnue(const Position& position);                       // from scratch, used outside of the search
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "psqt.hpp"
+
+#include <array>
+#include <cstdint>
+
+struct PawnEntry {
+    std::uint64_t key;          // pawn hash of the position
+    ScoreExt score;             // pawn structure score from white point of view
+};
+
+constexpr std::uint32_t pawnHashTableSize = 8192; // entries per thread, has to be a power of two
+
+class PawnHashTable {   // per thread cache of the pawn structure evaluation, entries only depend on pawn placement and never need clearing
+public:
+    PawnEntry& getEntry(std::uint64_t key) { return table[key & (pawnHashTableSize - 1)]; }
+
+    void resetStats() { probes = 0; hits = 0; }
+
+    std::uint64_t probes {0};
+    std::uint64_t hits {0};
+
+private:
+    std::array<PawnEntry, pawnHashTableSize> table {};
+};
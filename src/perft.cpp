@@ -1,68 +1,74 @@
 #include "perft.hpp"
 
-#include <iostream>
-
+#include "inputoutput.hpp"
 #include "move.hpp"
 #include "movegen.hpp"
 #include "movelist.hpp"
 #include "utils.hpp"
 
-
-//#include "movesorter.hpp"
-
+template<bool legal>
 std::uint64_t perftDriver(const Position& pos, const std::uint32_t depth) {
     if (depth == 0)
         return 1;
 
     std::uint64_t nodes = 0;
 
-//    MoveSorter moveSorter {pos};
-//    Move outMove;
-//    while (moveSorter.nextMove(outMove)){
-//        Position nextPos = pos;
-//        if (!nextPos.makeMove(outMove))
-//            continue;
-//
-//        nodes += perftDriver(nextPos, depth - 1);
-//    }
-
-    MoveList moveList;
-    generateMoves<MoveType::AllMoves>(moveList, pos);
+    LocalMoveList moveList;
+    if constexpr (legal) {
+        generateLegalMoves<MoveType::AllMoves>(moveList, pos);
+
+        // bulk counting, every generated move is legal
+        if (depth == 1) return moveList.getSize();
+    }
+    else {
+        generateMoves<MoveType::AllMoves>(moveList, pos);
+    }
+
     for (std::uint32_t count = 0; count < moveList.getSize(); ++count) {
         Position nextPos = pos;
-        if (!nextPos.makeMove(moveList[count].move))
+        nextPos.makeMove(moveList[count]);
+        if (!legal && nextPos.isInCheck(pos.sideToMove))
             continue;
 
-        nodes += perftDriver(nextPos, depth - 1);
+        nodes += perftDriver<legal>(nextPos, depth - 1);
     }
 
     return nodes;
 }
 
+template<bool legal>
 void perft(const Position& pos, const std::uint32_t depth) {
-    std::cout << "Perft to depthLimit " << depth << "\n\n";
+    writeLine("Perft to depthLimit ", depth, (legal ? " (legal" : " (pseudo legal"), " move generation)\n");
 
     TimePoint startTime = getTime();
     std::uint64_t nodes = 0;
 
 
-    MoveList moveList;
-    generateMoves<MoveType::AllMoves>(moveList, pos);
+    LocalMoveList moveList;
+    if constexpr (legal) generateLegalMoves<MoveType::AllMoves>(moveList, pos);
+    else                 generateMoves<MoveType::AllMoves>(moveList, pos);
+
     for (std::uint32_t count = 0; count < moveList.getSize(); ++count) {
         Position nextPos = pos;
-        if (!nextPos.makeMove(moveList[count].move)) {
+        nextPos.makeMove(moveList[count]);
+        if (!legal && nextPos.isInCheck(pos.sideToMove)) {
             continue;
         }
 
         std::uint64_t oldNodes = nodes;
-        nodes += perftDriver(nextPos, depth - 1);
+        nodes += perftDriver<legal>(nextPos, depth - 1);
 
-        std::cout << moveList[count].move << ": " << nodes - oldNodes << "\n";
+        writeLine(moveList[count], ": ", nodes - oldNodes);
     }
 
-    TimePoint elapsedTime = getTime() - startTime;
+    TimePoint elapsedTime = getTime() - startTime + 1;
     std::uint64_t nps = 1000 * nodes / elapsedTime;
-    std::cout << "\n\nNodes: " << nodes << std::endl;
-    std::cout << "Time: " << elapsedTime << "ms" << std::endl;
-    std::cout << "NPS: " << nps << std::endl;
+    writeLine("\n\nNodes: ", nodes);
+    writeLine("Time: ", elapsedTime, "ms");
+    writeLine("NPS: ", nps);
 }
+
+template std::uint64_t perftDriver<true>(const Position& pos, const std::uint32_t depth);
+template std::uint64_t perftDriver<false>(const Position& pos, const std::uint32_t depth);
+template void perft<true>(const Position& pos, const std::uint32_t depth);
+template void perft<false>(const Position& pos, const std::uint32_t depth);
@@ -2,5 +2,7 @@
 
 #include "position.hpp"
 
+template<bool legal>
 std::uint64_t perftDriver(const Position& pos, const std::uint32_t depth);
+template<bool legal>
 void perft(const Position& pos, const std::uint32_t depth);
@@ -1,6 +1,7 @@
 #include "position.hpp"
 
 #include "attacks.hpp"
+#include "movegen.hpp"
 #include "zobrist.hpp"
 
 #include <sstream>
@@ -78,98 +79,68 @@ void Position::loadFromFen(const std::string& fen) {
 
 void Position::setPiece(const Color color, const PieceType piece, const Square square) {
     Bitboard mask { square };
-    SidePosition& side = (color == Color::White) ? white : black;
 
-    side[piece] |= mask;
-    side.occupied |= mask;
-    occupied |= mask;
+    pieces[static_cast<std::uint8_t>(piece)] |= mask;
+    colors[static_cast<std::uint8_t>(color)] |= mask;
+    board[square.index()] = getPiece(piece, color);
+    psqtScore += pieceSquareScore[static_cast<std::uint8_t>(getPiece(piece, color))][square.index()];
+    phase += piecePhaseValue[static_cast<std::uint8_t>(piece)];
     hash ^= getPieceSquareHash(color, piece, square);
+    if (piece == PieceType::Pawn) pawnHash ^= getPieceSquareHash(color, piece, square);
 }
 
 void Position::removePiece(const Color color, const PieceType piece, const Square square) {
     Bitboard mask { square };
-    SidePosition& side = (color == Color::White) ? white : black;
 
-    side[piece] ^= mask;
-    side.occupied ^= mask;
-    occupied ^= mask;
+    pieces[static_cast<std::uint8_t>(piece)] ^= mask;
+    colors[static_cast<std::uint8_t>(color)] ^= mask;
+    board[square.index()] = Piece::None;
+    psqtScore -= pieceSquareScore[static_cast<std::uint8_t>(getPiece(piece, color))][square.index()];
+    phase -= piecePhaseValue[static_cast<std::uint8_t>(piece)];
     hash ^= getPieceSquareHash(color, piece, square);
+    if (piece == PieceType::Pawn) pawnHash ^= getPieceSquareHash(color, piece, square);
 }
 
-Bitboard Position::getPieces(const Color color, const PieceType pieceType) const {
-    if (color == Color::White) return white[pieceType];
-    else                       return black[pieceType];
-
-}
-
-Piece Position::pieceAt(const Square square) const {
-    Bitboard mask { square };
-
-    // check if square is occupied by white piece
-    if (white.pawns & mask) { return Piece::WhitePawn; }
-    if (white.knights & mask) { return Piece::WhiteKnight; }
-    if (white.bishops & mask) { return Piece::WhiteBishop; }
-    if (white.rooks & mask) { return Piece::WhiteRook; }
-    if (white.queens & mask) { return Piece::WhiteQueen; }
-    if (white.king & mask) { return Piece::WhiteKing; }
-
-    // check if square is occupied by black pieces
-    if (black.pawns & mask) { return Piece::BlackPawn; }
-    if (black.knights & mask) { return Piece::BlackKnight; }
-    if (black.bishops & mask) { return Piece::BlackBishop; }  
-    if (black.rooks & mask) { return Piece::BlackRook; }
-    if (black.queens & mask) { return Piece::BlackQueen; }
-    if (black.king & mask) { return Piece::BlackKing; }
-
-    // if square is not occupied by any piece, return Piece::None
-    return Piece::None;
-} 
-
 template<Color color>
 bool Position::isSquareAttackedBy(const Square square) const {
-    if constexpr (color == Color::White) {
-        if (white.pawns & getPawnAttacks(square, Color::Black))   { return true; }
-        if (white.knights & getKnightAttacks(square))             { return true; }
-        if (white.bishops & getBishopAttacks(square, occupied))   { return true; }
-        if (white.rooks & getRookAttacks(square, occupied))       { return true; }
-        if (white.queens & getQueenAttacks(square, occupied))     { return true; }
-        if (white.king & getKingAttacks(square))                  { return true; }
-    }
-    else {
-        if (black.pawns & getPawnAttacks(square, Color::White))   { return true; }
-        if (black.knights & getKnightAttacks(square))             { return true; }
-        if (black.bishops & getBishopAttacks(square, occupied))   { return true; }
-        if (black.rooks & getRookAttacks(square, occupied))       { return true; }
-        if (black.queens & getQueenAttacks(square, occupied))     { return true; }
-        if (black.king & getKingAttacks(square))                  { return true; }
-    }
+    const Bitboard occupied = getOccupied();
+    const Bitboard them = getOccupied<color>();
+
+    if (getPieces(PieceType::Pawn) & them & getPawnAttacks(square, ~color))                                         { return true; }
+    if (getPieces(PieceType::Knight) & them & getKnightAttacks(square))                                             { return true; }
+    if ((getPieces(PieceType::Bishop) | getPieces(PieceType::Queen)) & them & getBishopAttacks(square, occupied))   { return true; }
+    if ((getPieces(PieceType::Rook) | getPieces(PieceType::Queen)) & them & getRookAttacks(square, occupied))       { return true; }
+    if (getPieces(PieceType::King) & them & getKingAttacks(square))                                                 { return true; }
 
     return false;
 }
 
 Bitboard Position::getAttackers(Square square, const Bitboard occ) const {
-    const Bitboard knights  = white.knights | black.knights;
-    const Bitboard bishops  = white.bishops | black.bishops;
-    const Bitboard rooks    = white.rooks   | black.rooks;
-    const Bitboard queens   = white.queens  | black.queens;
-    const Bitboard kings    = white.king    | black.king;
+    const Bitboard knights  = getPieces(PieceType::Knight);
+    const Bitboard bishops  = getPieces(PieceType::Bishop);
+    const Bitboard rooks    = getPieces(PieceType::Rook);
+    const Bitboard queens   = getPieces(PieceType::Queen);
+    const Bitboard kings    = getPieces(PieceType::King);
+    const Bitboard pawns    = getPieces(PieceType::Pawn);
 
     Bitboard bitboard           = getKingAttacks(square) & kings;
     if (knights)                bitboard |= getKnightAttacks(square) & knights;
     if (rooks | queens)         bitboard |= getRookAttacks(square, occ) & (rooks | queens);
     if (bishops | queens)       bitboard |= getBishopAttacks(square, occ) & (bishops | queens);
-    if (white.pawns)   bitboard |= getPawnAttacks(square, Color::Black) & white.pawns;
-    if (black.pawns)   bitboard |= getPawnAttacks(square, Color::White) & black.pawns;
+    if (pawns) {
+        bitboard |= getPawnAttacks(square, Color::Black) & pawns & getOccupied<Color::White>();
+        bitboard |= getPawnAttacks(square, Color::White) & pawns & getOccupied<Color::Black>();
+    }
 
     return bitboard;
 }
 
 bool Position::isInCheck(const Color color) const {
-    if (color == Color::White)  { return isSquareAttackedBy<Color::Black>(white.king.lsb()); }
-    else                        { return isSquareAttackedBy<Color::White>(black.king.lsb()); }
+    if (color == Color::White)  { return isSquareAttackedBy<Color::Black>(getPieces<Piece::WhiteKing>().lsb()); }
+    else                        { return isSquareAttackedBy<Color::White>(getPieces<Piece::BlackKing>().lsb()); }
 }
 
-bool Position::makeMove(const Move move) {
+void Position::makeMove(const Move move) {
     const bool capture = move.isCapture();
     const bool doublePush = move.isDoublePush();
     const bool enpassant = move.isEnpassant();
@@ -230,11 +201,166 @@ bool Position::makeMove(const Move move) {
         hash ^= castlingRightZobristHash[static_cast<std::uint8_t>(castlingRights)];
     }
 
-    Color prevSideToMove = sideToMove;
     sideToMove = ~sideToMove;
     hash ^= colorZobristHash;
+}
+
+void Position::makeMove(const Move move, UndoInfo& undoInfo) {
+    undoInfo.capturedPiece = move.isEnpassant() ? getPiece(PieceType::Pawn, ~sideToMove) : move.isCapture() ? pieceAt(move.getTo()) : Piece::None;
+    undoInfo.castlingRights = castlingRights;
+    undoInfo.enPassantSquare = enPassantSquare;
+    undoInfo.halfMoveCounter = halfMoveCounter;
+    undoInfo.hash = hash;
+
+    makeMove(move);
+}
+
+void Position::unmakeMove(const Move move, const UndoInfo& undoInfo) {
+    sideToMove = ~sideToMove;
+
+    const Square from = move.getFrom();
+    const Square to = move.getTo();
+    const PieceType pieceType = getPieceType(move.getPiece());
 
-    return !isInCheck(prevSideToMove);
+    if (move.isPromotion()) {
+        removePiece(sideToMove, getPieceType(move.getPromotionPiece()), to);
+        setPiece(sideToMove, PieceType::Pawn, from);
+    }
+    else {
+        removePiece(sideToMove, pieceType, to);
+        setPiece(sideToMove, pieceType, from);
+    }
+
+    if (move.isCastling()) {
+        removePiece(sideToMove, PieceType::Rook, rookToCastling(to));
+        setPiece(sideToMove, PieceType::Rook, rookFromCastling(to));
+    }
+    else if (move.isCapture()) {
+        const Square capturedSquare = move.isEnpassant() ? Square(from.rank(), to.file()) : to;
+        setPiece(~sideToMove, getPieceType(undoInfo.capturedPiece), capturedSquare);
+    }
+
+    castlingRights = undoInfo.castlingRights;
+    enPassantSquare = undoInfo.enPassantSquare;
+    halfMoveCounter = undoInfo.halfMoveCounter;
+    hash = undoInfo.hash;
+}
+
+CheckInfo Position::computeCheckInfo() const {
+    const SidePosition us = getSide(sideToMove);
+    const SidePosition them = getSide(~sideToMove);
+    const Bitboard occupied = getOccupied();
+
+    CheckInfo checkInfo;
+    checkInfo.kingSquare = us[PieceType::King].lsb();
+    checkInfo.checkers = getAttackers(checkInfo.kingSquare, occupied) & them.occupied;
+
+    // opponent sliders aligned with our king with a single piece of ours in between
+    checkInfo.pinned = 0ULL;
+    Bitboard snipers = (getRookAttacks(checkInfo.kingSquare, 0ULL) & (them[PieceType::Rook] | them[PieceType::Queen]))
+                     | (getBishopAttacks(checkInfo.kingSquare, 0ULL) & (them[PieceType::Bishop] | them[PieceType::Queen]));
+    while (snipers) {
+        Square sniper = snipers.popLsb();
+        Bitboard blockers = getBetween(checkInfo.kingSquare, sniper) & occupied;
+        if (blockers && !blockers.several() && (blockers & us.occupied)) checkInfo.pinned |= blockers;
+    }
+
+    if (!checkInfo.checkers)                checkInfo.evasionMask = ~Bitboard(0ULL);
+    else if (checkInfo.checkers.several())  checkInfo.evasionMask = 0ULL;
+    else                                    checkInfo.evasionMask = getBetween(checkInfo.kingSquare, checkInfo.checkers.lsb()) | checkInfo.checkers;
+
+    return checkInfo;
+}
+
+bool Position::isLegal(const Move move, const CheckInfo& checkInfo) const {
+    const Square from = move.getFrom();
+    const Square to = move.getTo();
+    const Bitboard theirPieces = getOccupied(~sideToMove);
+
+    if (getPieceType(move.getPiece()) == PieceType::King) {
+        // castling is only generated when the king does not cross attacked squares
+        if (move.isCastling()) return true;
+        return !(getAttackers(to, getOccupied() ^ from) & theirPieces);
+    }
+
+    if (checkInfo.checkers.several()) return false;
+    if (move.isEnpassant()) return isLegalEnPassant(move, checkInfo);
+    if (!(checkInfo.evasionMask & to)) return false;
+    return !(checkInfo.pinned & from) || static_cast<bool>(getLine(checkInfo.kingSquare, from) & to);
+}
+
+bool Position::isLegalEnPassant(const Move move, const CheckInfo& checkInfo) const {
+    // en passant removes two pieces from the capturing rank, so we check the resulting occupancy directly
+    const Square from = move.getFrom();
+    const Square to = move.getTo();
+    const Square captured {from.rank(), to.file()};
+    const Bitboard theirPieces = getOccupied(~sideToMove);
+    const Bitboard occupancy = (getOccupied() ^ from ^ captured) | to;
+
+    return !(getAttackers(checkInfo.kingSquare, occupancy) & theirPieces & ~Bitboard(captured));
+}
+
+bool Position::isPseudoLegal(const Move move) const {
+    if (!move.isValid() || move.isNull()) return false;
+
+    const Square from = move.getFrom();
+    const Square to = move.getTo();
+    const Piece piece = move.getPiece();
+    const PieceType pieceType = getPieceType(piece);
+
+    if (getPieceColor(piece) != sideToMove || pieceAt(from) != piece) return false;
+
+    const Bitboard ourPieces = getOccupied(sideToMove);
+    const Bitboard theirPieces = getOccupied(~sideToMove);
+    const Bitboard occupied = ourPieces | theirPieces;
+    if (ourPieces & to) return false;
+
+    if (move.isCastling()) {
+        if (pieceType != PieceType::King) return false;
+        LocalMoveList moveList;
+        if (sideToMove == Color::White) generateCastlingMoves<Color::White>(moveList, *this);
+        else                            generateCastlingMoves<Color::Black>(moveList, *this);
+        return moveList.filter(move);
+    }
+
+    if (move.isEnpassant()) {
+        return pieceType == PieceType::Pawn && to == enPassantSquare && move.isCapture() && !move.isPromotion() && static_cast<bool>(getPawnAttacks(from, sideToMove) & to);
+    }
+
+    if (move.isCapture() != static_cast<bool>(theirPieces & to)) return false;
+
+    if (pieceType != PieceType::Pawn) {
+        if (move.isPromotion() || move.isDoublePush()) return false;
+
+        Bitboard attacks;
+        switch (pieceType) {
+            case PieceType::Knight: attacks = getKnightAttacks(from);           break;
+            case PieceType::Bishop: attacks = getBishopAttacks(from, occupied); break;
+            case PieceType::Rook:   attacks = getRookAttacks(from, occupied);   break;
+            case PieceType::Queen:  attacks = getQueenAttacks(from, occupied);  break;
+            default:                attacks = getKingAttacks(from);             break;
+        }
+        return static_cast<bool>(attacks & to);
+    }
+
+    // pawn moves
+    const std::uint8_t promotionRank = (sideToMove == Color::White) ? 7 : 0;
+    if ((to.rank() == promotionRank) != move.isPromotion()) return false;
+    if (move.isPromotion()) {
+        const Piece promotionPiece = move.getPromotionPiece();
+        const PieceType promotionPieceType = getPieceType(promotionPiece);
+        if (getPieceColor(promotionPiece) != sideToMove || promotionPieceType == PieceType::Pawn || promotionPieceType == PieceType::King) return false;
+    }
+
+    if (move.isCapture()) return !move.isDoublePush() && static_cast<bool>(getPawnAttacks(from, sideToMove) & to);
+
+    const Square singlePush = (sideToMove == Color::White) ? from.north() : from.south();
+    if (move.isDoublePush()) {
+        const std::uint8_t startRank = (sideToMove == Color::White) ? 1 : 6;
+        const Square doublePush = (sideToMove == Color::White) ? singlePush.north() : singlePush.south();
+        return from.rank() == startRank && to == doublePush && !(occupied & singlePush) && !(occupied & doublePush);
+    }
+    return to == singlePush && !(occupied & to);
 }
 
 bool Position::doNullMove() {
@@ -251,22 +377,32 @@ bool Position::doNullMove() {
     return true;
 }
 
+void Position::doNullMove(UndoInfo& undoInfo) {
+    undoInfo.capturedPiece = Piece::None;
+    undoInfo.castlingRights = castlingRights;
+    undoInfo.enPassantSquare = enPassantSquare;
+    undoInfo.halfMoveCounter = halfMoveCounter;
+    undoInfo.hash = hash;
+
+    doNullMove();
+}
+
+void Position::undoNullMove(const UndoInfo& undoInfo) {
+    sideToMove = ~sideToMove;
+    enPassantSquare = undoInfo.enPassantSquare;
+    halfMoveCounter = undoInfo.halfMoveCounter;
+    hash = undoInfo.hash;
+}
+
 std::uint64_t Position::computeHash() {
     std::uint64_t hashValue = (sideToMove == Color::Black) ? colorZobristHash : 0ULL;
 
     for (std::uint8_t pieceType = 0; pieceType < 6; pieceType++) {
-        Bitboard pieceBitboard = white[static_cast<PieceType>(pieceType)];
-        while (pieceBitboard) {
-            Square square = pieceBitboard.popLsb();
-            hashValue ^= getPieceSquareHash(Color::White, static_cast<PieceType>(pieceType), square);
-        }
-    }
-
-    for (std::uint8_t pieceType = 0; pieceType < 6; pieceType++) {
-        Bitboard pieceBitboard = black[static_cast<PieceType>(pieceType)];
+        Bitboard pieceBitboard = pieces[pieceType];
         while (pieceBitboard) {
             Square square = pieceBitboard.popLsb();
-            hashValue ^= getPieceSquareHash(Color::Black, static_cast<PieceType>(pieceType), square);
+            const Color color = (colors[static_cast<std::uint8_t>(Color::White)] & square) ? Color::White : Color::Black;
+            hashValue ^= getPieceSquareHash(color, static_cast<PieceType>(pieceType), square);
         }
     }
 
@@ -305,14 +441,14 @@ std::ostream& operator<<(std::ostream& output, const Position& pos) {
     output << "\n    Half move counter: " << pos.halfMoveCounter;
     output << "\n\n    Hash Value: 0x" << std::hex << pos.hash << std::dec << std::endl;
 
-    // output << "\n\n    White occupied: \n" << pos.white.occupied;
-    // output << "\n\n    Black occupied: \n" << pos.black.occupied;
-    // output << "\n\n    All occupied: \n" << pos.occupied;
+    // output << "\n\n    White occupied: \n" << pos.getOccupied<Color::White>();
+    // output << "\n\n    Black occupied: \n" << pos.getOccupied<Color::Black>();
+    // output << "\n\n    All occupied: \n" << pos.getOccupied();
 
     return output;
 }
 
 bool Position::hasNonPawnMaterial(Color color) const {
-    const SidePosition& side = (color == Color::White) ? white : black;
-    return side.knights != 0 || side.bishops != 0 || side.rooks != 0 || side.queens != 0;
+    const Bitboard nonPawnMaterial = getPieces(PieceType::Knight) | getPieces(PieceType::Bishop) | getPieces(PieceType::Rook) | getPieces(PieceType::Queen);
+    return (nonPawnMaterial & getOccupied(color)) != 0;
 }
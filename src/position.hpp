@@ -4,8 +4,10 @@
 #include "color.hpp"
 #include "move.hpp"
 #include "piece.hpp"
+#include "psqt.hpp"
 #include "square.hpp"
 
+#include <cstddef>
 #include <string>
 
 enum class CastlingRight : std::uint8_t {
@@ -44,68 +46,90 @@ constexpr CastlingRight castlingRightUpdate[64] = {
     CastlingRight::BlackQueenRookMoved, CastlingRight::Rest, CastlingRight::Rest, CastlingRight::Rest,  CastlingRight::BlackKingMoved, CastlingRight::Rest, CastlingRight::Rest, CastlingRight::BlackKingRookMoved,
 };
 
-struct SidePosition // substructure of Position containing all pieces of one color
+struct SidePosition // view of the pieces of one color, built from the piece type and color bitboards of Position
 {
-    Bitboard& operator[](const PieceType piece) {
-        return (&pawns)[static_cast<std::uint8_t>(piece)];
-    }
     Bitboard operator[](const PieceType piece) const {
-        return (&pawns)[static_cast<std::uint8_t>(piece)];
+        return pieces[static_cast<std::uint8_t>(piece)] & occupied;
     }
 
-    Bitboard occupied {0};  // all squares occupied by side pieces
+    const Bitboard* pieces;     // piece type bitboards of the position (both colors)
+    Bitboard occupied;          // all squares occupied by side pieces
+};
+
+struct CheckInfo  // check and pin information of the side to move, computed once per position for legal move generation
+{
+    Square kingSquare;
+    Bitboard checkers;      // opponent pieces giving check
+    Bitboard pinned;        // our pieces pinned to our king
+    Bitboard evasionMask;   // squares where non-king pieces must move to resolve a check
+};
 
-    Bitboard pawns {0};
-    Bitboard knights {0};
-    Bitboard bishops {0};
-    Bitboard rooks {0};
-    Bitboard queens {0};
-    Bitboard king {0};
+struct UndoInfo  // state which can't be recovered from the move when unmaking it
+{
+    Piece capturedPiece;
+    CastlingRight castlingRights;
+    Square enPassantSquare;
+    std::uint16_t halfMoveCounter;
+    std::uint64_t hash;
 };
 
-class Position
+class alignas(64) Position  // piece type major layout: all bitboards share one cache line, occupancy is derived
 {
 public:
-    SidePosition white;               // pieces information for white
-    SidePosition black;               // pieces information for black
+    Bitboard pieces[6];             // squares occupied by each piece type (both colors)
+    Bitboard colors[2];             // squares occupied by each color
 
-    Bitboard occupied;                // all squares occupied by any piece
+    Piece board[64];                // mailbox of the piece on each square, kept in sync with the bitboards
+
+    std::uint64_t hash;
+    std::uint64_t pawnHash;         // hash of the pawn placement only, used by the pawn hash table
 
     Color sideToMove;               // side to move
     Square enPassantSquare;         // en passant square
     CastlingRight castlingRights;    // castling rights (encoded as bits) 0001 = white king side, 0010 = white queen side, 0100 = black king side, 1000 = black queen side
     std::uint16_t halfMoveCounter;
 
-    std::uint64_t hash;
+    ScoreExt psqtScore;             // material and PSQT from white point of view, updated incrementally
+    std::int16_t phase;             // game phase from the remaining non-pawn material
 
-    constexpr Position() : sideToMove{Color::White}, enPassantSquare{Square::None}, castlingRights{CastlingRight::None}, halfMoveCounter{}, hash{} {};
+    constexpr Position() : pieces{}, colors{}, board{}, hash{}, pawnHash{}, sideToMove{Color::White}, enPassantSquare{Square::None}, castlingRights{CastlingRight::None}, halfMoveCounter{}, psqtScore{}, phase{} {
+        for (Piece& piece : board) piece = Piece::None;
+    };
     void loadFromFen(const std::string& fen);                                     // load position from FEN string
 
     void setPiece(const Color color, const PieceType piece, const Square square);  // set piece at given square
     void removePiece(const Color color, const PieceType piece, const Square square);   // remove piece at given square
-    Piece pieceAt(const Square square) const;                                      // return piece at given square
+    Piece pieceAt(const Square square) const { return board[square.index()]; }   // return piece at given square
 
-    bool makeMove(const Move move);                                                // make move on position
+    void makeMove(const Move move);                                                // make move on position
+    void makeMove(const Move move, UndoInfo& undoInfo);                            // make move and record how to unmake it
+    void unmakeMove(const Move move, const UndoInfo& undoInfo);                    // unmake move made with makeMove(move, undoInfo)
+    bool isPseudoLegal(const Move move) const;                                     // check if move could have been generated in this position
+    bool isLegal(const Move move, const CheckInfo& checkInfo) const;               // check if pseudo legal move leaves our king safe
+    bool isLegalEnPassant(const Move move, const CheckInfo& checkInfo) const;
+    CheckInfo computeCheckInfo() const;
 
     bool doNullMove();
+    void doNullMove(UndoInfo& undoInfo);
+    void undoNullMove(const UndoInfo& undoInfo);
     bool hasNonPawnMaterial(Color color) const;
 
     template<Piece piece>
     constexpr Bitboard getPieces() const {
         constexpr Color color = getPieceColor(piece);
         constexpr PieceType pieceType = getPieceType(piece);
-        
-        if constexpr (color == Color::White) { return white[pieceType]; }
-        if constexpr (color == Color::Black) { return black[pieceType]; }
+
+        return pieces[static_cast<std::uint8_t>(pieceType)] & colors[static_cast<std::uint8_t>(color)];
     }
     template<Color color>
     constexpr Bitboard getOccupied() const {
-        if constexpr (color == Color::White) { return white.occupied; }
-        if constexpr (color == Color::Black) { return black.occupied; }
+        return colors[static_cast<std::uint8_t>(color)];
     }
-
-
-    Bitboard getPieces(const Color color, const PieceType pieceType) const;
+    constexpr Bitboard getPieces(const PieceType pieceType) const { return pieces[static_cast<std::uint8_t>(pieceType)]; }
+    constexpr Bitboard getPieces(const Color color, const PieceType pieceType) const { return getPieces(pieceType) & getOccupied(color); }
+    constexpr Bitboard getOccupied(const Color color) const { return colors[static_cast<std::uint8_t>(color)]; }
+    constexpr Bitboard getOccupied() const { return colors[0] | colors[1]; }
+    constexpr SidePosition getSide(const Color color) const { return {pieces, getOccupied(color)}; }
 
     template<Color color>
     bool isSquareAttackedBy(const Square square) const;                           // check if square is attacked by given color
@@ -115,3 +139,6 @@ public:
     std::uint64_t computeHash();
     friend std::ostream& operator<<(std::ostream& output, const Position& pos);     // output operator
 };
+
+static_assert(offsetof(Position, board) == 64, "Position bitboards should fill exactly one cache line");
+static_assert(offsetof(Position, hash) == 128, "Position mailbox should fill exactly one cache line");
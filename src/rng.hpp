@@ -1,3 +1,5 @@
+#pragma once
+
 /*  Written in 2018 by David Blackman and Sebastiano Vigna (vigna@acm.org)
 
 To the extent possible under law, the author has dedicated all copyright
@@ -21,7 +23,7 @@ See <http://creativecommons.org/publicdomain/zero/1.0/>. */
    output to fill s. */
 
 
-inline std::uint64_t rotl(const std::uint64_t x, int k) {
+constexpr std::uint64_t rotl(const std::uint64_t x, int k) {
 	return (x << k) | (x >> (64 - k));
 }
 
@@ -30,7 +32,7 @@ private:
     std::uint64_t s[4]{};
 
 public:
-    std::uint64_t next() {
+    constexpr std::uint64_t next() {
         const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
 
         const std::uint64_t t = s[1] << 17;
@@ -47,11 +49,11 @@ public:
         return result;
     }
 
-    std::uint64_t nextSparse() {
+    constexpr std::uint64_t nextSparse() {
         return next() & next() & next();
     }
 
-    explicit PRNG(std::uint64_t seed) {
+    explicit constexpr PRNG(std::uint64_t seed) {
         s[0] = seed;
         s[1] = seed;
         s[2] = seed;
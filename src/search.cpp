@@ -1,58 +1,183 @@
 #include "search.hpp"
 
+#include "cuckoo.hpp"
 #include "evaluate.hpp"
+#include "inputoutput.hpp"
+#include "movegen.hpp"
 #include "see.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <sstream>
 
 std::uint8_t lateMoveReductionTable[64][64];
 
 void Search::startSearch(const Game& game, const SearchLimits& searchLimits) {
+    searchStartTime = getTimeMicroseconds();
+
     // stop any previous search
     stopSearch();
+    stopRequestTime = 0;
 
     Position position = game.getCurrentPosition();
 
-    // Setting thread data
-    data.searchLimits = searchLimits;
-    data.game = &game;
+    // Setting thread data, all threads share the transposition table but own their search stack and heuristics tables
+    for (std::uint32_t threadId = 0; threadId < threadsData.size(); threadId++) {
+        ThreadData& data = threadsData[threadId];
+
+        data.searchLimits = searchLimits;
+        if (searchLimits.nodeLimit != noNodeLimit) data.searchLimits.nodeLimit = std::max<std::uint64_t>(searchLimits.nodeLimit / threadsData.size(), 1);
+
+        data.searchStack[0].clear();
+        getPosition(data, &data.searchStack[0]) = position;
+        data.searchStack[0].inCheck = position.isInCheck(position.sideToMove);
+
+        // positions before the last irreversible move can't repeat, only the end of the game history is kept
+        const std::vector<std::uint64_t>& positionHistory = game.getPositionHistory();
+        data.gameHistorySize = std::min<std::uint32_t>({static_cast<std::uint32_t>(positionHistory.size()), position.halfMoveCounter + 1u, maxGameHistory});
+        std::copy(positionHistory.end() - data.gameHistorySize, positionHistory.end(), data.gameHistory.begin());
+        data.searchStack[0].pliesFromNull = data.gameHistorySize - 1;
+
+        data.threadId = threadId;
+        data.isMainThread = (threadId == 0);
+        data.useNnue = useNnue;
+        data.multiPv = multiPv;
+        data.pvIndex = 0;
+        data.searchStats = {};
+
+        data.moveHistoryTable = {};
+        data.killerMoveTable = {};
+        data.counterMoveTable = {};
+        data.pawnHashTable.resetStats();
+    }
 
-    data.searchStack[0].position = position;
-    data.searchStack[0].inCheck = position.isInCheck(position.sideToMove);
+    transpositionTable.newSearch();
 
-    data.isMainThread = true;
-    data.searchStats = {};
+    // waking up the worker threads
+    searchStop = false;
+    ponderTimeBudget = (searchLimits.timeLimit != invalidTimePoint) ? searchLimits.timeLimit - searchLimits.searchTimeStart : invalidTimePoint;
+    if (searchLimits.timeLimit != invalidTimePoint && !searchLimits.ponder) armTimer(searchLimits.timeLimit);
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        pondering = searchLimits.ponder;
+        activeThreads = threadsData.size();
+        searchId++;
+    }
+    threadCondition.notify_all();
+}
 
-    data.moveHistoryTable = {};
-    data.killerMoveTable = {};
-    data.counterMoveTable = {};
+void Search::threadLoop(ThreadData& threadData, std::uint64_t lastSearchId) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(threadMutex);
+            threadCondition.wait(lock, [&] { return exitThreads || searchId != lastSearchId; });
+            if (exitThreads) return;
+            lastSearchId = searchId;
+        }
 
-    // launching search on thread
-    searchStop = false;
-    thread = std::thread(&Search::searchInternal, this, std::ref(data));
+        searchInternal(threadData);
+
+        {
+            std::lock_guard<std::mutex> lock(threadMutex);
+            activeThreads--;
+        }
+        threadCondition.notify_all();
+    }
+}
+
+void Search::startThreads(std::uint32_t threadCount) {
+    threadsData.resize(threadCount);
+    exitThreads = false;
+    for (ThreadData& data : threadsData) {
+        threads.emplace_back(&Search::threadLoop, this, std::ref(data), searchId);
+    }
+}
+
+void Search::stopThreads() {
+    stopSearch();
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        exitThreads = true;
+    }
+    threadCondition.notify_all();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
 }
 
 void Search::searchInternal(ThreadData& threadData) {
     NodeData &rootNode = threadData.searchStack[0];
     rootNode.previousMove = Move::Invalid();
 
+    if (threadData.isMainThread) startLatency = getTimeMicroseconds() - searchStartTime;
+
+    // the root accumulators are built once, the whole tree is then updated from them
+    if (threadData.useNnue) {
+        for (const Color perspective : {Color::White, Color::Black}) {
+            refreshAccumulator(rootNode.accumulator, getPosition(threadData, &rootNode), perspective);
+        }
+    }
+
+    // helper threads skip some iterations so that they do not all search the same tree
+    const std::uint32_t skipIndex = (threadData.threadId - 1) % skipDepthTableSize;
+
+    // the node limit applies once the first iteration is done so that there is always a best move to report
+    const std::uint64_t nodeLimit = threadData.searchLimits.nodeLimit;
+    threadData.searchLimits.nodeLimit = noNodeLimit;
+
+    // no more lines than legal root moves, so that every line has a move to search
+    LocalMoveList rootMoves;
+    generateLegalMoves<MoveType::AllMoves>(rootMoves, getPosition(threadData, &rootNode));
+    const std::uint32_t lineCount = std::clamp<std::uint32_t>(rootMoves.getSize(), 1, threadData.multiPv);
+
     Move bestMoveSoFar;
-    Score previousScore = invalidScore;
+    Move ponderMoveSoFar;
+    std::array<Score, maxMultiPv> previousScores;
+    std::fill(previousScores.begin(), previousScores.begin() + lineCount, invalidScore);
     for (std::int16_t currentDepth = 1; currentDepth <= threadData.searchLimits.depthLimit; currentDepth++) {
-        rootNode.depth = currentDepth;
-        aspirationWindow(threadData, &rootNode, previousScore);
+        if (!threadData.isMainThread && ((currentDepth + skipDepthPhase[skipIndex]) / skipDepthSize[skipIndex]) % 2) continue;
+
+        for (threadData.pvIndex = 0; threadData.pvIndex < lineCount && !searchStop; threadData.pvIndex++) {
+            rootNode.depth = currentDepth;
+            aspirationWindow(threadData, &rootNode, previousScores[threadData.pvIndex]);
+            threadData.multiPvLines[threadData.pvIndex] = rootNode.pvLine;
+        }
+        threadData.searchLimits.nodeLimit = nodeLimit;
 
         if (searchStop) break;
 
-        previousScore = rootNode.pvLine.score;
+        // a later line can come out better than an earlier one, the lines are reported best first
+        std::stable_sort(threadData.multiPvLines.begin(), threadData.multiPvLines.begin() + lineCount, [](const PvLine& lhs, const PvLine& rhs) { return lhs.score > rhs.score; });
+        for (std::uint32_t index = 0; index < lineCount; index++) {
+            previousScores[index] = threadData.multiPvLines[index].score;
+        }
+
         if (threadData.isMainThread) {
-            reportInfo(threadData, &rootNode, threadData.searchStats);
-            bestMoveSoFar = rootNode.pvLine.moves[0];
+            for (std::uint32_t index = 0; index < lineCount; index++) {
+                reportInfo(threadData, currentDepth, threadData.multiPvLines[index], index);
+            }
+            const PvLine& bestLine = threadData.multiPvLines[0];
+            bestMoveSoFar = bestLine.moves[0];
+            ponderMoveSoFar = (bestLine.pvLength > 1) ? bestLine.moves[1] : Move::Invalid();
         }
     }
 
     if (threadData.isMainThread) {
-        reportResult(bestMoveSoFar);
+        // the main thread decides when the search is over
+        searchStop = true;
+        if (bestMoveSoFar.isValid() && !ponderMoveSoFar.isValid()) ponderMoveSoFar = getPonderMove(getPosition(threadData, &rootNode), bestMoveSoFar);
+        {
+            // a finished ponder search must not report before the GUI resolves it with ponderhit or stop
+            std::unique_lock<std::mutex> lock(threadMutex);
+            threadCondition.wait(lock, [&] { return !pondering; });
+        }
+        disarmTimer();
+        reportResult(bestMoveSoFar, ponderMoveSoFar);
+
+        const std::int64_t requestTime = stopRequestTime;
+        stopLatency = requestTime ? getTimeMicroseconds() - requestTime : 0;
     }
 }
 
@@ -61,7 +186,7 @@ void Search::aspirationWindow(ThreadData &threadData, NodeData *rootNode, Score
     Score alpha = -infValue;
     Score beta  = +infValue;
 
-    if (rootNode->depth >= aspirationWindowMinDepth) {
+    if (rootNode->depth >= aspirationWindowMinDepth && previousScore != invalidScore) {
         alpha = std::min<std::int32_t>(previousScore - delta, +infValue);
         beta  = std::max<std::int32_t>(previousScore + delta, -infValue);
     }
@@ -95,65 +220,188 @@ void Search::aspirationWindow(ThreadData &threadData, NodeData *rootNode, Score
 
 
 void Search::stopSearch() {
+    if (!searchStop) stopRequestTime = getTimeMicroseconds();
     searchStop = true;
-    if (thread.joinable()) thread.join();
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        pondering = false;
+    }
+    threadCondition.notify_all();
+    waitForSearch();
+}
+
+void Search::ponderHit() {
+    // the expected move was played, the search goes on and the clock starts now
+    std::lock_guard<std::mutex> lock(threadMutex);
+    if (!pondering) return;
+    if (ponderTimeBudget != invalidTimePoint) armTimer(getTime() + ponderTimeBudget);
+    pondering = false;
+    threadCondition.notify_all();
 }
 
-bool Search::checkStopCondition(SearchLimits& searchLimits, SearchStats& searchStats){
-    // check time limits every 2048 nodes if needed
-    if (searchLimits.timeLimit != invalidTimePoint && ((searchStats.negamaxNodeCounter + searchStats.quiescenceNodeCounter) % 2048) == 0) {
-        if (getTime() >= searchLimits.timeLimit) {
+void Search::timerLoop() {
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (!exitTimer) {
+        if (!timerArmed) {
+            timerCondition.wait(lock);
+        }
+        else if (std::chrono::steady_clock::now() >= timerDeadline) {
+            stopRequestTime = std::chrono::duration_cast<std::chrono::microseconds>(timerDeadline.time_since_epoch()).count();
             searchStop = true;
-            return true;
+            timerArmed = false;
+        }
+        else {
+            timerCondition.wait_until(lock, timerDeadline);
         }
     }
-    return false;
 }
 
-void Search::reportInfo(ThreadData& threadData, NodeData* nodeData, SearchStats& searchStats) {
-    std::uint64_t totalNodes = searchStats.negamaxNodeCounter + searchStats.quiescenceNodeCounter;
+void Search::armTimer(TimePoint deadline) {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timerDeadline = std::chrono::steady_clock::time_point {std::chrono::milliseconds {deadline}};
+        timerArmed = true;
+    }
+    timerCondition.notify_one();
+}
+
+void Search::disarmTimer() {
+    std::lock_guard<std::mutex> lock(timerMutex);
+    timerArmed = false;
+}
+
+void Search::stopTimer() {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        exitTimer = true;
+    }
+    timerCondition.notify_one();
+    timerThread.join();
+}
+
+void Search::waitForSearch() {
+    std::unique_lock<std::mutex> lock(threadMutex);
+    threadCondition.wait(lock, [&] { return activeThreads == 0; });
+}
+
+void Search::setThreadCount(std::uint32_t threadCount) {
+    stopThreads();
+    startThreads(std::clamp<std::uint32_t>(threadCount, 1, maxThreadCount));
+}
+
+std::uint64_t Search::getNodeCount() const {
+    std::uint64_t totalNodes = 0;
+    for (const ThreadData& data : threadsData) {
+        totalNodes += data.searchStats.negamaxNodeCounter + data.searchStats.quiescenceNodeCounter;
+    }
+    return totalNodes;
+}
+
+std::uint64_t Search::getPawnHashProbes() const {
+    std::uint64_t totalProbes = 0;
+    for (const ThreadData& data : threadsData) {
+        totalProbes += data.pawnHashTable.probes;
+    }
+    return totalProbes;
+}
+
+std::uint64_t Search::getPawnHashHits() const {
+    std::uint64_t totalHits = 0;
+    for (const ThreadData& data : threadsData) {
+        totalHits += data.pawnHashTable.hits;
+    }
+    return totalHits;
+}
+
+void Search::clear() {
+    transpositionTable.clear(threadsData.size());
+    for (ThreadData& data : threadsData) {
+        data.evalCache = {};
+    }
+}
+
+std::uint64_t Search::getEvaluationCount() const {
+    std::uint64_t totalEvaluations = 0;
+    for (const ThreadData& data : threadsData) {
+        totalEvaluations += data.searchStats.evaluationCounter;
+    }
+    return totalEvaluations;
+}
+
+void Search::reportInfo(ThreadData& threadData, std::int16_t depth, const PvLine& pvLine, std::uint32_t multiPvIndex) {
+    std::uint64_t totalNodes = getNodeCount();
     TimePoint searchTime = (getTime() - threadData.searchLimits.searchTimeStart + 1);
     std::uint32_t nps = totalNodes / searchTime * 1000;
-    Score score = nodeData->pvLine.score;
+    Score score = pvLine.score;
 
-    std::cout << "info depth " << nodeData->depth;
-    std::cout << " nodes " << totalNodes;
-    std::cout << " time " << searchTime << "ms";
-    std::cout << " nps " << nps;
+    std::ostringstream info;
+    info << "info depth " << depth;
+    info << " multipv " << multiPvIndex + 1;
+    info << " nodes " << totalNodes;
+    info << " time " << searchTime << "ms";
+    info << " nps " << nps;
 
     if (score > checkmateInMaxPly)
-        std::cout << " score mate " << (checkmateValue - score);
+        info << " score mate " << (checkmateValue - score);
     else if (score < - checkmateInMaxPly)
-        std::cout << " score mate " << -(checkmateValue + score);
+        info << " score mate " << -(checkmateValue + score);
     else
-        std::cout << " score cp " << score;
+        info << " score cp " << score;
 
-    std::cout << " pv ";
-    for (std::uint32_t i = 0; i < nodeData->pvLine.pvLength; i++) {
-        std::cout << nodeData->pvLine.moves[i] << " ";
+    info << " pv ";
+    for (std::uint32_t i = 0; i < pvLine.pvLength; i++) {
+        info << pvLine.moves[i] << " ";
     }
 
 #ifdef SEARCH_STATS
-    std::cout << "\nStats: NegamaxNodes: " << searchStats.negamaxNodeCounter;
-    std::cout << "\nStats: QuiescenceNodes: " << searchStats.quiescenceNodeCounter;
-    std::cout << "\nStats: BetaCutoff: " << searchStats.betaCutoff;
-    std::cout << "\nStats: TTHits: " << searchStats.ttHits;
+    const SearchStats& searchStats = threadData.searchStats;
+    info << "\nStats: NegamaxNodes: " << searchStats.negamaxNodeCounter;
+    info << "\nStats: QuiescenceNodes: " << searchStats.quiescenceNodeCounter;
+    info << "\nStats: BetaCutoff: " << searchStats.betaCutoff;
+    info << "\nStats: TTHits: " << searchStats.ttHits;
+    info << "\nStats: PawnHashHits: " << threadData.pawnHashTable.hits << " / " << threadData.pawnHashTable.probes;
 #endif
 
-    std::cout << std::endl;
+    writeString(info.str());
 }
 
-void Search::reportResult(Move bestMove) {
-    std::cout << "bestmove " << bestMove << std::endl;
+bool Search::isExcludedRootMove(const ThreadData& threadData, Move move) {
+    for (std::uint32_t index = 0; index < threadData.pvIndex; index++) {
+        if (threadData.multiPvLines[index].moves[0] == move) return true;
+    }
+    return false;
+}
+
+Move Search::getPonderMove(const Position& rootPosition, Move bestMove) {
+    // the root PV can be cut by a TT hit after the first move, the expected reply is then read from the TT
+    Position position = rootPosition;
+    position.makeMove(bestMove);
+
+    TTEntry entry;
+    if (!transpositionTable.probeTable(position.hash, entry)) return Move::Invalid();
+
+    const Move move = entry.getMove();
+    const CheckInfo checkInfo = position.computeCheckInfo();
+    return (move.isValid() && position.isPseudoLegal(move) && position.isLegal(move, checkInfo)) ? move : Move::Invalid();
+}
+
+void Search::reportResult(Move bestMove, Move ponderMove) {
+    std::ostringstream result;
+    result << "bestmove " << bestMove;
+    if (ponderMove.isValid()) result << " ponder " << ponderMove;
+    writeString(result.str());
 }
 
 template<NodeType nodeType>
 Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& searchStats) {
 
-    if (searchStop || checkStopCondition(threadData.searchLimits, searchStats)) return invalidScore;
+    if (searchStop.load(std::memory_order_relaxed)) return invalidScore;
+    if (searchStats.negamaxNodeCounter + searchStats.quiescenceNodeCounter >= threadData.searchLimits.nodeLimit) {
+        searchStop = true;
+        return invalidScore;
+    }
 
-    const Position& currentPosition = nodeData->position;
-    const Score oldAlpha = nodeData->alpha;
+    const Position& currentPosition = getPosition(threadData, nodeData);
     const std::int16_t depth = nodeData->depth;
     const bool inCheck = nodeData->inCheck;
 
@@ -164,32 +412,41 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
     nodeData->pvLine.pvLength = 0;
     searchStats.negamaxNodeCounter++;
 
-    if (!rootNode && (currentPosition.halfMoveCounter >= 100 || checkInsufficientMaterial(currentPosition) || isRepetition(nodeData, threadData.game))) return drawValue;
+    if (!rootNode && (currentPosition.halfMoveCounter >= 100 || checkInsufficientMaterial(currentPosition) || isRepetition(threadData, nodeData))) return drawValue;
 
     if (depth <= 0) return quiescenceNegamax(threadData, nodeData, searchStats);
 
     if (nodeData->ply >= maxSearchDepth - 1) {
-        WARNING("Hit Max Depth search in negamax search, ply count: " << nodeData->ply << "\n")
-        return evaluate(currentPosition);
+        WARNING("Hit Max Depth search in negamax search, ply count: " << nodeData->ply)
+        return evaluate(currentPosition, threadData.pawnHashTable);
+    }
+
+    // the side to move can go back to a position of the search path, the node is worth at least a draw
+    if (!rootNode && nodeData->alpha < drawValue && hasUpcomingRepetition(threadData, nodeData)) {
+        nodeData->alpha = drawValue;
+        if (drawValue >= nodeData->beta) return drawValue;
     }
 
+    const Score oldAlpha = nodeData->alpha;
     Score alpha = oldAlpha;
     Score beta = nodeData->beta;
 
     TTEntry entry;
     Move ttMove = Move::Invalid();
+    Score ttStaticEval = invalidScore;
     if (transpositionTable.probeTable(currentPosition.hash, entry)) {
 #ifdef SEARCH_STATS
         searchStats.ttHits++;
 #endif
-        if (!rootNode && entry.depth >= depth) {
+        if (!rootNode && entry.getDepth() >= depth) {
             Score ttScore = TranspositionTable::ScoreFromTT(entry.score, nodeData->ply);
 
-            if (entry.bound == Bound::Exact)                     return ttScore;
-            if (entry.bound == Bound::Upper && ttScore <= alpha) return ttScore;
-            if (entry.bound == Bound::Lower && ttScore >= beta)  return ttScore;
+            if (entry.getBound() == Bound::Exact)                     return ttScore;
+            if (entry.getBound() == Bound::Upper && ttScore <= alpha) return ttScore;
+            if (entry.getBound() == Bound::Lower && ttScore >= beta)  return ttScore;
         }
-        ttMove = entry.move;
+        ttMove = entry.getMove();
+        ttStaticEval = entry.staticEval;
     }
 
     NodeData& childNode = *(nodeData + 1);
@@ -199,7 +456,7 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
 
     if constexpr (!pvNode) {
         if (!inCheck) {
-            Score eval = evaluate(currentPosition);
+            Score eval = getStaticEvaluation(threadData, nodeData, ttStaticEval, searchStats);
 
             if (depth <= reverseFutilityDepth &&
                 eval >= beta &&
@@ -214,15 +471,16 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
 
                 std::int16_t reduction = depth / 4 + nullMovePruningDepthReduction;
 
-                childNode.position = currentPosition;
-                childNode.position.doNullMove();
+                makeNullMove(threadData, nodeData);
                 childNode.previousMove = Move::Null();
+                if (!threadData.useNnue) childNode.staticEval = 2 * tempoBonus - eval;    // a null move only flips the side to move and the tempo bonus
                 childNode.depth = depth - reduction;
                 childNode.inCheck = false;
                 childNode.alpha = -beta;
                 childNode.beta = -beta + 1;
 
                 Score nullScore = -negamax<NodeType::NonPv>(threadData, &childNode, searchStats);
+                unmakeNullMove(threadData, nodeData);
 
                 if (nullScore >= beta) {
                     return (nullScore >= checkmateInMaxPly) ? beta : nullScore;
@@ -231,8 +489,8 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
         }
     }
 
-    const Move counterMove = (nodeData->previousMove.isValid() && !nodeData->previousMove.isNull()) ? data.counterMoveTable[static_cast<std::uint8_t>(nodeData->previousMove.getPiece())][nodeData->previousMove.getTo().index()] : Move::Invalid();
-    MoveSorter moveSorter {currentPosition, ttMove, threadData.moveHistoryTable, threadData.killerMoveTable[nodeData->ply], counterMove};
+    const Move counterMove = (nodeData->previousMove.isValid() && !nodeData->previousMove.isNull()) ? threadData.counterMoveTable[static_cast<std::uint8_t>(nodeData->previousMove.getPiece())][nodeData->previousMove.getTo().index()] : Move::Invalid();
+    MoveSorter moveSorter {threadData.moveArena, currentPosition, ttMove, threadData.moveHistoryTable, threadData.killerMoveTable[nodeData->ply], counterMove};
     std::uint8_t moveCount = 0;
     std::uint8_t quietMoveCount = 0;
     Move outMove;
@@ -245,16 +503,12 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
 
     bool skipQuiet = false;
     while (moveSorter.nextMove(outMove, skipQuiet, false)) {
-        childNode.position = currentPosition;
-        if (!childNode.position.makeMove(outMove))
-            continue;
-
-        transpositionTable.prefetchTable(childNode.position.hash);
+        if constexpr (rootNode) {
+            if (threadData.pvIndex > 0 && isExcludedRootMove(threadData, outMove)) continue;
+        }
 
         moveCount++;
         if (outMove.isQuiet()) quietMoveCount++;
-        childNode.previousMove = outMove;
-        childNode.inCheck = childNode.position.isInCheck(childNode.position.sideToMove);
 
         if constexpr (!pvNode) {
             if (!inCheck) {
@@ -275,6 +529,15 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
             }
         }
 
+        makeMove(threadData, nodeData, outMove);
+        const Position& childPosition = getPosition(threadData, &childNode);
+
+        transpositionTable.prefetchTable(childPosition.hash);
+
+        childNode.previousMove = outMove;
+        childNode.staticEval = invalidScore;
+        childNode.inCheck = childPosition.isInCheck(childPosition.sideToMove);
+
         std::int16_t depthReduction;
         if (outMove.isQuiet()) {
             depthReduction = lateMoveReductionTable[std::min<std::int16_t>(depth, 63)][moveCount];
@@ -338,6 +601,8 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
             }
         }
 
+        unmakeMove(threadData, nodeData, outMove);
+
         if (score > bestScore) {
             bestScore = score;
             bestMove = outMove;
@@ -374,9 +639,10 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
         }
     }
 
-    if(!searchStop) {
+    // the root entry of a secondary MultiPV line would describe a position with excluded moves
+    if(!searchStop && !(rootNode && threadData.pvIndex > 0)) {
         Bound bound = (bestScore >= beta) ? Bound::Lower : (bestScore > oldAlpha) ? Bound::Exact : Bound::Upper;
-        transpositionTable.writeEntry(currentPosition, depth, TranspositionTable::ScoreToTT(bestScore, nodeData->ply), bestMove, bound);
+        transpositionTable.writeEntry(currentPosition.hash, depth, TranspositionTable::ScoreToTT(bestScore, nodeData->ply), nodeData->staticEval, bestMove, bound);
     }
 
     return bestScore;
@@ -384,9 +650,13 @@ Score Search::negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& s
 
 Score Search::quiescenceNegamax(ThreadData &threadData, NodeData *nodeData, SearchStats& searchStats) {
 
-    if (searchStop || checkStopCondition(threadData.searchLimits, searchStats)) return invalidScore;
+    if (searchStop.load(std::memory_order_relaxed)) return invalidScore;
+    if (searchStats.negamaxNodeCounter + searchStats.quiescenceNodeCounter >= threadData.searchLimits.nodeLimit) {
+        searchStop = true;
+        return invalidScore;
+    }
 
-    const Position& currentPosition = nodeData->position;
+    const Position& currentPosition = getPosition(threadData, nodeData);
     const Score oldAlpha = nodeData->alpha;
 
     searchStats.quiescenceNodeCounter++;
@@ -396,24 +666,26 @@ Score Search::quiescenceNegamax(ThreadData &threadData, NodeData *nodeData, Sear
 
     TTEntry entry;
     Move ttMove = Move::Invalid();
+    Score ttStaticEval = invalidScore;
     if (transpositionTable.probeTable(currentPosition.hash, entry)) {
 #ifdef SEARCH_STATS
         searchStats.ttHits++;
 #endif
         Score ttScore = TranspositionTable::ScoreFromTT(entry.score, nodeData->ply);
 
-        if (entry.bound == Bound::Exact)                     return ttScore;
-        if (entry.bound == Bound::Upper && ttScore <= alpha) return ttScore;
-        if (entry.bound == Bound::Lower && ttScore >= beta)  return ttScore;
+        if (entry.getBound() == Bound::Exact)                     return ttScore;
+        if (entry.getBound() == Bound::Upper && ttScore <= alpha) return ttScore;
+        if (entry.getBound() == Bound::Lower && ttScore >= beta)  return ttScore;
 
-        ttMove = entry.move;
+        ttMove = entry.getMove();
+        ttStaticEval = entry.staticEval;
     }
 
-    Score staticEvaluation = evaluate(currentPosition);
+    Score staticEvaluation = getStaticEvaluation(threadData, nodeData, ttStaticEval, searchStats);
     Score bestScore = staticEvaluation;
 
     if (nodeData->ply >= maxSearchDepth - 1) {
-        WARNING("Hit Max Depth search in Quiescence search, ply count: " << nodeData->ply << "\n")
+        WARNING("Hit Max Depth search in Quiescence search, ply count: " << nodeData->ply)
         return staticEvaluation;
     }
 
@@ -423,8 +695,8 @@ Score Search::quiescenceNegamax(ThreadData &threadData, NodeData *nodeData, Sear
     if (alpha < bestScore)
         alpha = bestScore;
 
-    const Move counterMove = (nodeData->previousMove.isValid() && !nodeData->previousMove.isNull()) ? data.counterMoveTable[static_cast<std::uint8_t>(nodeData->previousMove.getPiece())][nodeData->previousMove.getTo().index()] : Move::Invalid();
-    MoveSorter moveSorter {currentPosition, ttMove, threadData.moveHistoryTable, threadData.killerMoveTable[nodeData->ply], counterMove};
+    const Move counterMove = (nodeData->previousMove.isValid() && !nodeData->previousMove.isNull()) ? threadData.counterMoveTable[static_cast<std::uint8_t>(nodeData->previousMove.getPiece())][nodeData->previousMove.getTo().index()] : Move::Invalid();
+    MoveSorter moveSorter {threadData.moveArena, currentPosition, ttMove, threadData.moveHistoryTable, threadData.killerMoveTable[nodeData->ply], counterMove};
     Move outMove;
     Move bestMove = Move::Invalid();
 
@@ -433,15 +705,15 @@ Score Search::quiescenceNegamax(ThreadData &threadData, NodeData *nodeData, Sear
     childNode.ply = nodeData->ply + 1;
 
     while (moveSorter.nextMove(outMove, true, true)) {
-        childNode.position = currentPosition;
-        if (!childNode.position.makeMove(outMove))
-            continue;
+        makeMove(threadData, nodeData, outMove);
 
         childNode.alpha = -beta;
         childNode.beta = -alpha;
         childNode.previousMove = outMove;
+        childNode.staticEval = invalidScore;
 
         Score score = -quiescenceNegamax(threadData, &childNode, searchStats);
+        unmakeMove(threadData, nodeData, outMove);
 
         if (score > bestScore) {
             bestScore = score;
@@ -462,38 +734,145 @@ Score Search::quiescenceNegamax(ThreadData &threadData, NodeData *nodeData, Sear
 
     if(!searchStop) {
         Bound bound = (bestScore >= beta) ? Bound::Lower : (bestScore > oldAlpha) ? Bound::Exact : Bound::Upper;
-        transpositionTable.writeEntry(currentPosition, 0, TranspositionTable::ScoreToTT(bestScore, nodeData->ply), bestMove, bound);
+        transpositionTable.writeEntry(currentPosition.hash, 0, TranspositionTable::ScoreToTT(bestScore, nodeData->ply), staticEvaluation, bestMove, bound);
     }
 
     return bestScore;
 }
 
-bool Search::isRepetition(NodeData* nodeData, const Game* game) {
-    NodeData* previousNode = nodeData;
-    std::uint32_t plyCounter = 0;
+Score Search::getStaticEvaluation(ThreadData& threadData, NodeData* nodeData, Score ttStaticEval, SearchStats& searchStats) {
+    // reuse the evaluation given by the parent node, the transposition table or the eval cache before computing it
+    if (nodeData->staticEval != invalidScore) return nodeData->staticEval;
 
-    const std::uint64_t targetHash = nodeData->position.hash;
+    const Position& position = getPosition(threadData, nodeData);
+    Score eval = ttStaticEval;
+    if (eval == invalidScore && !threadData.evalCache.probe(position.hash, eval)) {
+        eval = threadData.useNnue ? evaluateNetwork(threadData, nodeData) : evaluate(position, threadData.pawnHashTable);
+        threadData.evalCache.store(position.hash, eval);
+        searchStats.evaluationCounter++;
+    }
 
-    // Check for repetition inside the current search
-    while (previousNode->ply > 0) {
-        // Irreversible moves
-        const Move& prevMove = previousNode->previousMove;
-        if (prevMove.isCapture() || (prevMove.getPiece() == getPiece(PieceType::Pawn, ~previousNode->position.sideToMove))) {
-            return false;
+    nodeData->staticEval = eval;
+    return eval;
+}
+
+Score Search::evaluateNetwork(ThreadData& threadData, NodeData* nodeData) {
+    const Position& position = getPosition(threadData, nodeData);
+
+    for (const Color perspective : {Color::White, Color::Black}) {
+        const std::uint8_t index = static_cast<std::uint8_t>(perspective);
+        if (nodeData->accumulator.computed[index]) continue;
+
+        // walk back to the closest computed accumulator, the walk stops at a king bucket change or at the root
+        NodeData* lastComputed = nodeData;
+        while (!lastComputed->accumulator.computed[index] && lastComputed->ply > 0 && !lastComputed->dirtyPieces.refresh[index]) {
+            lastComputed--;
+        }
+
+        // a node after a king bucket change is rebuilt from its own position so that its subtree is updated from it,
+        // with make/unmake only the current position is available and these nodes are rebuilt when the move is made
+        if (!lastComputed->accumulator.computed[index]) {
+            refreshAccumulator(lastComputed->accumulator, getPosition(threadData, lastComputed), perspective);
         }
 
-        --previousNode;
-        ++plyCounter;
+        const Square kingSquare = position.getPieces(perspective, PieceType::King).lsb();
+        for (NodeData* node = lastComputed + 1; node <= nodeData; node++) {
+            updateAccumulator((node - 1)->accumulator, node->accumulator, node->dirtyPieces, kingSquare, perspective);
+        }
+    }
 
-        if (plyCounter % 2 == 0) {
-            if (previousNode->position.hash == targetHash) {
-                return true;
-            }
+    return evaluateNnue(nodeData->accumulator, position.sideToMove);
+}
+
+std::uint64_t Search::getPreviousHash(const ThreadData& threadData, NodeData* nodeData, std::int32_t distance) {
+    // hash of the position distance plies before the node, from the search stack then from the game history
+    if (distance <= nodeData->ply) return getNodeHash(nodeData - distance);
+    return threadData.gameHistory[threadData.gameHistorySize - 1 - (distance - nodeData->ply)];
+}
+
+bool Search::isRepetition(ThreadData& threadData, NodeData* nodeData) {
+    const Position& position = getPosition(threadData, nodeData);
+    const std::int32_t reversiblePlies = std::min<std::int32_t>(position.halfMoveCounter, nodeData->pliesFromNull);
+
+    // only positions with the same side to move and no irreversible move in between can repeat
+    for (std::int32_t distance = 2; distance <= reversiblePlies; distance += 2) {
+        if (getPreviousHash(threadData, nodeData, distance) == position.hash) return true;
+    }
+    return false;
+}
+
+bool Search::hasUpcomingRepetition(ThreadData& threadData, NodeData* nodeData) {
+    const Position& position = getPosition(threadData, nodeData);
+    const Bitboard occupied = position.getOccupied();
+
+    // odd distances only, the previous position must be reached by a move of the side to move, and within the search
+    const std::int32_t reversiblePlies = std::min<std::int32_t>({position.halfMoveCounter, nodeData->pliesFromNull, nodeData->ply - 1});
+    for (std::int32_t distance = 3; distance <= reversiblePlies; distance += 2) {
+        const std::uint64_t moveKey = position.hash ^ getPreviousHash(threadData, nodeData, distance);
+
+        std::uint32_t index = cuckooIndex1(moveKey);
+        if (cuckooTable.keys[index] != moveKey) {
+            index = cuckooIndex2(moveKey);
+            if (cuckooTable.keys[index] != moveKey) continue;
+        }
+
+        if (!(getBetween(Square {cuckooTable.from[index]}, Square {cuckooTable.to[index]}) & occupied)) return true;
+    }
+    return false;
+}
+
+void Search::makeMove([[maybe_unused]] ThreadData& threadData, NodeData* nodeData, Move move) {
+    if (threadData.useNnue) {
+        NodeData& childNode = *(nodeData + 1);
+        childNode.dirtyPieces = getDirtyPieces(getPosition(threadData, nodeData), move);
+        childNode.accumulator.computed[0] = childNode.accumulator.computed[1] = false;
+    }
+
+    (nodeData + 1)->pliesFromNull = nodeData->pliesFromNull + 1;
+
+#ifdef MAKE_UNMAKE
+    threadData.position.makeMove(move, nodeData->undoInfo);
+    if (threadData.useNnue) {
+        NodeData& childNode = *(nodeData + 1);
+        for (const Color perspective : {Color::White, Color::Black}) {
+            if (childNode.dirtyPieces.refresh[static_cast<std::uint8_t>(perspective)]) refreshAccumulator(childNode.accumulator, threadData.position, perspective);
         }
     }
+#else
+    NodeData& childNode = *(nodeData + 1);
+    childNode.position = nodeData->position;
+    childNode.position.makeMove(move);
+#endif
+}
+
+void Search::unmakeMove([[maybe_unused]] ThreadData& threadData, [[maybe_unused]] NodeData* nodeData, [[maybe_unused]] Move move) {
+#ifdef MAKE_UNMAKE
+    threadData.position.unmakeMove(move, nodeData->undoInfo);
+#endif
+}
 
-    // Check for repetition outside the current search
-    return game->checkRepetition(targetHash);
+void Search::makeNullMove([[maybe_unused]] ThreadData& threadData, NodeData* nodeData) {
+    if (threadData.useNnue) {
+        NodeData& childNode = *(nodeData + 1);
+        childNode.dirtyPieces = getNullDirtyPieces();
+        childNode.accumulator.computed[0] = childNode.accumulator.computed[1] = false;
+    }
+
+    (nodeData + 1)->pliesFromNull = 0;
+
+#ifdef MAKE_UNMAKE
+    threadData.position.doNullMove(nodeData->undoInfo);
+#else
+    NodeData& childNode = *(nodeData + 1);
+    childNode.position = nodeData->position;
+    childNode.position.doNullMove();
+#endif
+}
+
+void Search::unmakeNullMove([[maybe_unused]] ThreadData& threadData, [[maybe_unused]] NodeData* nodeData) {
+#ifdef MAKE_UNMAKE
+    threadData.position.undoNullMove(nodeData->undoInfo);
+#endif
 }
 
 constexpr Score Search::futilityMargin(std::int16_t depth) {
@@ -502,7 +881,7 @@ constexpr Score Search::futilityMargin(std::int16_t depth) {
 
 void Search::updateQuietMoveOrdering(ThreadData &threadData, NodeData *nodeData, Move bestMove) {
     // history heuristic
-    const Color sideToMove = nodeData->position.sideToMove;
+    const Color sideToMove = getPosition(threadData, nodeData).sideToMove;
     std::int32_t &history = threadData.moveHistoryTable[static_cast<std::uint8_t>(sideToMove)][bestMove.getFrom().index()][bestMove.getTo().index()];
 
     std::int32_t bonus = (nodeData->depth * nodeData->depth);
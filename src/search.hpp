@@ -1,16 +1,24 @@
 #pragma once
 
+#include "evalcache.hpp"
 #include "game.hpp"
 #include "move.hpp"
 #include "movesorter.hpp"
+#include "nnue.hpp"
+#include "pawnhashtable.hpp"
 #include "position.hpp"
 #include "transpositiontable.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 constexpr Score aspirationWindowStart = 20;
 constexpr Score aspirationWindowMinDepth = 5;
@@ -33,6 +41,13 @@ constexpr std::int16_t seePruningDepth = 8;
 constexpr std::int32_t scaleNonQuietSeePruning = -80;
 constexpr std::int32_t scaleQuietSeePruning = -30;
 
+constexpr std::uint32_t maxThreadCount = 256;
+constexpr std::uint32_t maxMultiPv = 256;
+constexpr std::uint32_t maxGameHistory = 101;   // positions before the root that can still repeat, bounded by the fifty-move rule
+constexpr std::uint32_t skipDepthTableSize = 20;
+constexpr std::int16_t skipDepthSize[skipDepthTableSize]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr std::int16_t skipDepthPhase[skipDepthTableSize] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
 
 void initSearchParameters();
 
@@ -48,14 +63,24 @@ struct PvLine {
     Score score;
 };
 
+constexpr std::uint64_t noNodeLimit = UINT64_MAX;
+
 struct SearchLimits {
     std::uint8_t depthLimit;
     TimePoint searchTimeStart;
     TimePoint timeLimit;
+    std::uint64_t nodeLimit = noNodeLimit;     // nodes searched by each thread, the go nodes budget is split between threads
+    bool ponder = false;                       // search on the opponent time, the time limit only starts on ponderhit
 };
 
+// The search either copies the position into the child node before making a move (copy-make, default),
+// or updates a single position per thread and restores it from an undo record (build with -DMAKE_UNMAKE)
 struct NodeData {
+#ifdef MAKE_UNMAKE
+    UndoInfo undoInfo;          // undo record of the move played from this node
+#else
     Position position;
+#endif
     bool inCheck;
 
     Score alpha;
@@ -63,25 +88,37 @@ struct NodeData {
 
     std::int16_t depth;
     std::int16_t ply;
+    std::uint16_t pliesFromNull;   // plies that can be walked back before a null move or the start of the game history
 
     PvLine pvLine;
     Move previousMove;
+    Score staticEval;           // static evaluation of the node, invalidScore until computed or inherited from the parent
+
+    DirtyPieces dirtyPieces;    // piece changes of the move leading to this node, NNUE only
+    Accumulator accumulator;    // NNUE accumulators, computed lazily from the closest computed ancestor
 
     void clear() {
+#ifndef MAKE_UNMAKE
         position = {};
+#endif
         inCheck = {};
         alpha = {};
         beta = {};
         depth = {};
         ply = {};
+        pliesFromNull = {};
         pvLine.pvLength = 0;
         previousMove = Move::Invalid();
+        staticEval = invalidScore;
+        dirtyPieces = getNullDirtyPieces();
+        accumulator.computed[0] = accumulator.computed[1] = false;
     }
 };
 
 struct SearchStats {
     std::uint64_t negamaxNodeCounter;
     std::uint64_t quiescenceNodeCounter;
+    std::uint64_t evaluationCounter;
 
 #ifdef SEARCH_STATS
     std::uint64_t betaCutoff;
@@ -91,37 +128,95 @@ struct SearchStats {
 
 struct ThreadData {
     SearchLimits searchLimits;
-    const Game* game;
 
+#ifdef MAKE_UNMAKE
+    Position position;
+#endif
     std::array<NodeData, maxSearchDepth> searchStack;
 
+    // hashes of the last reversible game positions, the root position last
+    std::array<std::uint64_t, maxGameHistory> gameHistory;
+    std::uint32_t gameHistorySize;
+
+    std::uint32_t threadId;
     bool isMainThread;
+    bool useNnue;
+
+    // MultiPV, line pvIndex is searched with the first moves of the previous lines excluded at the root
+    std::uint32_t multiPv;
+    std::uint32_t pvIndex;
+    std::array<PvLine, maxMultiPv> multiPvLines;
     SearchStats searchStats;
 
+    MoveArena moveArena;            // move lists of the nodes of the current line
     MoveHistoryTable moveHistoryTable;
     KillerMoveTable killerMoveTable;
     CounterMoveTable counterMoveTable;
+    PawnHashTable pawnHashTable;
+    EvalCache evalCache;
 };
 
+#ifdef MAKE_UNMAKE
+constexpr const char* moveMakingName = "make/unmake";
+#else
+constexpr const char* moveMakingName = "copy-make";
+#endif
+
 class Search {
 public:
+    Search() { timerThread = std::thread(&Search::timerLoop, this); startThreads(1); };
+    ~Search() { stopThreads(); stopTimer(); };
+
     void startSearch(const Game& game, const SearchLimits& searchLimits);
     void stopSearch();
+    void ponderHit();
     void searchInternal(ThreadData& threadData);
-    void clear() { transpositionTable.clear(); };
-    void resizeTT(std::uint64_t newMemorySize) { transpositionTable.initTable(newMemorySize); };
+    void clear();
+    void resizeTT(std::uint64_t newMemorySize) { transpositionTable.initTable(newMemorySize, threadsData.size()); };
     void setStopSearchFlag(const bool flag) { searchStop = flag; };
+    void setThreadCount(std::uint32_t threadCount);
+    void setUseNnue(bool value) { useNnue = value; clear(); };     // cached evaluations of the other backend are discarded
+    bool isUsingNnue() const { return useNnue; };
+    void setMultiPv(std::uint32_t value) { multiPv = std::clamp<std::uint32_t>(value, 1, maxMultiPv); };
+    void waitForSearch();
+    std::uint64_t getNodeCount() const;
+    std::uint64_t getEvaluationCount() const;
+    std::int64_t getStartLatency() const { return startLatency; };
+    std::int64_t getStopLatency() const { return stopLatency; };
+    std::uint64_t getPawnHashProbes() const;
+    std::uint64_t getPawnHashHits() const;
 
 private:
-    static void reportInfo(ThreadData& threadData, NodeData* nodeData, SearchStats& searchStats);
-    static void reportResult(Move bestMove);
-    bool checkStopCondition(SearchLimits& searchLimits, SearchStats& searchStats);
-
-    static bool isRepetition(NodeData* nodeData, const Game* game);
+    void startThreads(std::uint32_t threadCount);
+    void stopThreads();
+    void threadLoop(ThreadData& threadData, std::uint64_t lastSearchId);
+
+    void timerLoop();
+    void armTimer(TimePoint deadline);
+    void disarmTimer();
+    void stopTimer();
+
+    void reportInfo(ThreadData& threadData, std::int16_t depth, const PvLine& pvLine, std::uint32_t multiPvIndex);
+    Move getPonderMove(const Position& rootPosition, Move bestMove);
+    static void reportResult(Move bestMove, Move ponderMove);
+
+    static bool isExcludedRootMove(const ThreadData& threadData, Move move);
+    static std::uint64_t getPreviousHash(const ThreadData& threadData, NodeData* nodeData, std::int32_t distance);
+    static bool isRepetition(ThreadData& threadData, NodeData* nodeData);
+    static bool hasUpcomingRepetition(ThreadData& threadData, NodeData* nodeData);
+    static Score getStaticEvaluation(ThreadData& threadData, NodeData* nodeData, Score ttStaticEval, SearchStats& searchStats);
+    static Score evaluateNetwork(ThreadData& threadData, NodeData* nodeData);
     static constexpr Score futilityMargin(std::int16_t depth);
     static constexpr std::uint32_t lateMovePruningThreshold(std::int16_t depth);
     static void updateQuietMoveOrdering(ThreadData& threadData, NodeData* nodeData, Move bestMove);
 
+    static void makeMove(ThreadData& threadData, NodeData* nodeData, Move move);
+    static void unmakeMove(ThreadData& threadData, NodeData* nodeData, Move move);
+    static void makeNullMove(ThreadData& threadData, NodeData* nodeData);
+    static void unmakeNullMove(ThreadData& threadData, NodeData* nodeData);
+    static constexpr Position& getPosition(ThreadData& threadData, NodeData* nodeData);
+    static constexpr std::uint64_t getNodeHash(NodeData* nodeData);
+
     template<NodeType nodeType>
     Score negamax(ThreadData& threadData, NodeData* nodeData, SearchStats& searchStats);
     Score quiescenceNegamax(ThreadData& threadData, NodeData* nodeData, SearchStats& searchStats);
@@ -129,14 +224,58 @@ private:
 
     // Global data
     std::atomic<bool> searchStop;
-    TranspositionTable transpositionTable {8 * 1024 * 1024};
-
-
-    // Thread specific data
-    ThreadData data;
-    std::thread thread;
-
-
+    TranspositionTable transpositionTable {defaultTTSizeMiB * 1024 * 1024};
+    bool useNnue = false;
+    std::uint32_t multiPv = 1;
+
+
+    // Thread specific data, index 0 is the main thread
+    std::vector<ThreadData> threadsData;
+    std::vector<std::thread> threads;
+
+    // Thread pool synchronisation, workers are parked on the condition variable between searches
+    std::mutex threadMutex;
+    std::condition_variable threadCondition;
+    std::uint64_t searchId = 0;
+    std::uint32_t activeThreads = 0;
+    bool exitThreads = false;
+
+    // Timer thread, raises searchStop at the deadline of a time limited search so that nodes only poll the flag
+    std::thread timerThread;
+    std::mutex timerMutex;
+    std::condition_variable timerCondition;
+    std::chrono::steady_clock::time_point timerDeadline;
+    bool timerArmed = false;
+    bool exitTimer = false;
+
+    // Pondering, the best move is held back until ponderhit or stop and the time budget is armed on ponderhit
+    bool pondering = false;
+    TimePoint ponderTimeBudget = invalidTimePoint;
+
+    // Time between the go command and the first node searched by the main thread, in microseconds
+    std::int64_t searchStartTime;
+    std::int64_t startLatency;
+
+    // Time between the stop request (stop command or deadline) and the best move output, in microseconds
+    std::atomic<std::int64_t> stopRequestTime {0};
+    std::int64_t stopLatency = 0;
 };
 
+constexpr Position& Search::getPosition([[maybe_unused]] ThreadData& threadData, [[maybe_unused]] NodeData* nodeData) {
+#ifdef MAKE_UNMAKE
+    return threadData.position;
+#else
+    return nodeData->position;
+#endif
+}
+
+// hash of a node of the search stack, for ancestors of the current node with make/unmake it's recorded in the undo record
+constexpr std::uint64_t Search::getNodeHash(NodeData* nodeData) {
+#ifdef MAKE_UNMAKE
+    return nodeData->undoInfo.hash;
+#else
+    return nodeData->position.hash;
+#endif
+}
+
 
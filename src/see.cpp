@@ -3,6 +3,7 @@
 #include "attacks.hpp"
 #include "bitboard.hpp"
 #include "color.hpp"
+#include "inputoutput.hpp"
 #include "movegen.hpp"
 #include "square.hpp"
 
@@ -24,8 +25,8 @@ bool staticExchangeEvaluation(const Position &position, const Move move, std::in
     const Bitboard blackOccupied = position.getOccupied<Color::Black>();
 
     Bitboard occupied = (whiteOccupied | blackOccupied) ^ from;
-    Bitboard bishopQueenBitboard = position.white.bishops | position.black.bishops | position.white.queens | position.black.queens;
-    Bitboard rookQueenBitboard = position.white.rooks | position.black.bishops | position.white.queens | position.black.queens;
+    Bitboard bishopQueenBitboard = position.getPieces(PieceType::Bishop) | position.getPieces(PieceType::Queen);
+    Bitboard rookQueenBitboard = position.getPieces(PieceType::Rook) | position.getPieces(PieceType::Queen);
 
     Bitboard attackers = position.getAttackers(to, occupied);
     Color sideToMove = ~position.sideToMove;
@@ -67,9 +68,9 @@ bool staticExchangeEvaluation(const Position &position, const Move move, std::in
 }
 
 void testSee(const Position& position) {
-    MoveList moveList;
+    LocalMoveList moveList;
     generateMoves<MoveType::NonQuietMoves>(moveList, position);
     for (std::uint32_t i = 0; i < moveList.getSize(); ++i) {
-        std::cout << "Testing move " << moveList[i].move << " : " << (staticExchangeEvaluation(position, moveList[i].move, 0) ? "Good capture" : "Bad capture") << std::endl;
+        writeLine("Testing move ", moveList[i], " : ", (staticExchangeEvaluation(position, moveList[i], 0) ? "Good capture" : "Bad capture"));
     }
 }
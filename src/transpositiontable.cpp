@@ -1,29 +1,103 @@
 #include "transpositiontable.hpp"
 
-void TranspositionTable::initTable(std::uint64_t newMemorySize) {
-    std::uint64_t newSize = newMemorySize / sizeof(TTEntry);
-    delete[] table;
-    table = new TTEntry[newSize];
-    size = newSize;
-    clear();
-    std::cout << "Transposition Table size: (" << size << ", " << (size * sizeof(TTEntry)) << "B, " << ((size * sizeof(TTEntry)) / (1024. * 1024.)) << "MiB)" << std::endl;
+#include "inputoutput.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+void TranspositionTable::initTable(std::uint64_t newMemorySize, std::uint32_t threadCount) {
+    freeTable();
+    allocateTable(newMemorySize);
+    clear(threadCount);
+    writeLine("Transposition Table size: (", clusterCount * clusterSize, " entries, ", clusterCount * sizeof(TTCluster), "B, ", (clusterCount * sizeof(TTCluster)) / (1024. * 1024.), "MiB)");
+}
+
+void TranspositionTable::allocateTable(std::uint64_t memorySize) {
+    // try to back the table with 2 MiB pages to avoid TLB misses on probes
+    const std::uint64_t alignedSize = ((memorySize + hugePageSize - 1) / hugePageSize) * hugePageSize;
+    table = static_cast<TTCluster*>(std::aligned_alloc(hugePageSize, alignedSize));
+    if (table) {
+#ifdef __linux__
+        madvise(table, alignedSize, MADV_HUGEPAGE);
+#endif
+        clusterCount = memorySize / sizeof(TTCluster);
+        return;
+    }
+
+    // fallback on cache line aligned memory
+    const std::uint64_t fallbackSize = (memorySize / sizeof(TTCluster)) * sizeof(TTCluster);
+    table = static_cast<TTCluster*>(std::aligned_alloc(alignof(TTCluster), fallbackSize));
+    if (table) {
+        clusterCount = memorySize / sizeof(TTCluster);
+        return;
+    }
+
+    writeLine("info string error: failed to allocate ", memorySize, "B for the transposition table");
+    clusterCount = 0;
 }
 
-void TranspositionTable::writeEntry(const Position &position, std::int16_t depth, ScoreTT score, Move move, Bound bound) {
+void TranspositionTable::freeTable() {
+    std::free(table);
+    table = nullptr;
+    clusterCount = 0;
+}
+
+void TranspositionTable::writeEntry(std::uint64_t hash, std::int16_t depth, ScoreTT score, ScoreTT staticEval, Move move, Bound bound) {
     if (!table) return;
 
-    TTEntry& entry = table[position.hash % size];
-    entry.hash =  position.hash;
-    entry.depth = depth;
-    entry.bound = bound;
-    entry.move = move;
-    entry.score = score;
+    TTCluster& cluster = table[getIndex(hash)];
+    const std::uint16_t key = static_cast<std::uint16_t>(hash);
+
+    // use the entry of the same position or an empty one if any, otherwise replace the shallowest and oldest entry
+    TTEntry* replace = &cluster.entries[0];
+    for (TTEntry& entry : cluster.entries) {
+        if (entry.key == key || entry.isEmpty()) {
+            replace = &entry;
+            break;
+        }
+
+        if (entry.depth - 8 * relativeAge(entry) < replace->depth - 8 * relativeAge(*replace))
+            replace = &entry;
+    }
+
+    // keep the move of a previous search of the same position if we don't have one
+    if (move.isValid() || replace->key != key) {
+        replace->moveLow = static_cast<std::uint16_t>(move.getValue());
+        replace->moveHigh = static_cast<std::uint16_t>(move.getValue() >> 16);
+    }
+
+    // same for the static evaluation, which only depends on the position
+    if (staticEval != invalidScore || replace->key != key) {
+        replace->staticEval = staticEval;
+    }
+
+    // don't overwrite deeper information of the same position from the current search
+    if (bound == Bound::Exact || replace->key != key || depth - depthEntryOffset + 4 > replace->depth || relativeAge(*replace) != 0) {
+        replace->key = key;
+        replace->depth = static_cast<std::uint8_t>(depth - depthEntryOffset);
+        replace->generationBound = generation | static_cast<std::uint8_t>(bound);
+        replace->score = score;
+    }
 }
 
 bool TranspositionTable::probeTable(std::uint64_t hash, TTEntry &outEntry) {
     if (table) {
-        outEntry = table[hash % size];
-        if (outEntry.hash == hash) return true;
+        const TTCluster& cluster = table[getIndex(hash)];
+        const std::uint16_t key = static_cast<std::uint16_t>(hash);
+
+        for (const TTEntry& entry : cluster.entries) {
+            if (entry.key == key && !entry.isEmpty()) {
+                outEntry = entry;
+                return true;
+            }
+        }
     }
     return false;
 }
@@ -41,12 +115,26 @@ Score TranspositionTable::ScoreFromTT(ScoreTT score, std::int16_t ply) {
     return score;
 }
 
-void TranspositionTable::clear() {
-    for (std::uint32_t index = 0; index < size; index++) {
-        table[index] = {};
+void TranspositionTable::clear(std::uint32_t threadCount) {
+    // clearing is split across threads, which is also the first touch of the pages
+    std::vector<std::thread> threads;
+    const std::uint64_t clustersPerThread = (clusterCount + threadCount - 1) / threadCount;
+
+    for (std::uint32_t threadId = 0; threadId < threadCount; threadId++) {
+        const std::uint64_t start = std::min(clusterCount, threadId * clustersPerThread);
+        const std::uint64_t end = std::min(clusterCount, start + clustersPerThread);
+
+        threads.emplace_back([this, start, end]() {
+            std::memset(static_cast<void*>(table + start), 0, (end - start) * sizeof(TTCluster));
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
     }
+    generation = 0;
 }
 
 void TranspositionTable::prefetchTable(std::uint64_t hash) {
-    __builtin_prefetch(&table[hash % size]);
+    __builtin_prefetch(&table[getIndex(hash)]);
 }
@@ -12,29 +12,66 @@ enum class Bound: std::uint8_t {
     Exact
 };
 
-struct TTEntry {
-    std::uint64_t hash;
-    std::int16_t depth;
+// the low bits of the generation byte hold the bound, the generation itself is stored in the upper 6 bits
+constexpr std::uint8_t generationBits  = 2;
+constexpr std::uint8_t generationDelta = 1 << generationBits;
+constexpr std::uint8_t generationMask  = (0xFF << generationBits) & 0xFF;
+constexpr std::uint16_t generationCycle = 0xFF + generationDelta;
+
+// depth is stored with an offset so that an empty entry has a depth of 0
+constexpr std::int16_t depthEntryOffset = -1;
 
-    Bound bound;
+struct TTEntry {
+    std::uint16_t key;          // low 16 bits of the position hash, the high bits are used for indexing
+    std::uint8_t depth;
+    std::uint8_t generationBound;
     ScoreTT score;
-    Move move;
+    ScoreTT staticEval;         // static evaluation of the position, invalidScore if it was not computed
+    std::uint16_t moveLow;      // move is split in two halves to keep the entry 2-byte aligned (12 bytes)
+    std::uint16_t moveHigh;
+
+    constexpr std::int16_t getDepth() const { return static_cast<std::int16_t>(depth) + depthEntryOffset; }
+    constexpr Bound getBound() const { return static_cast<Bound>(generationBound & (generationDelta - 1)); }
+    constexpr Move getMove() const { return {static_cast<std::uint32_t>(moveLow) | (static_cast<std::uint32_t>(moveHigh) << 16)}; }
+    constexpr bool isEmpty() const { return depth == 0; }
 };
 
+constexpr std::uint32_t clusterSize = 5;
+
+constexpr std::uint64_t defaultTTSizeMiB = 8;
+constexpr std::uint64_t maxTTSizeMiB = 131072;
+constexpr std::uint64_t hugePageSize = 2 * 1024 * 1024;
+
+struct alignas(64) TTCluster {
+    TTEntry entries[clusterSize];
+    std::uint8_t padding[4];
+};
+
+static_assert(sizeof(TTEntry) == 12, "TTEntry should be 12 bytes");
+static_assert(sizeof(TTCluster) == 64, "TTCluster should fit in a cache line");
+
 class TranspositionTable {
 public:
-    explicit TranspositionTable(std::uint64_t initSize) : table{nullptr}, size{0} { initTable(initSize); };
-    ~TranspositionTable() { delete[] table; };
+    explicit TranspositionTable(std::uint64_t initSize) : table{nullptr}, clusterCount{0}, generation{0} { initTable(initSize, 1); };
+    ~TranspositionTable() { freeTable(); };
 
-    void initTable(std::uint64_t newMemorySize);
-    void writeEntry(const Position& position, std::int16_t depth, ScoreTT score, Move move, Bound bound);
+    void initTable(std::uint64_t newMemorySize, std::uint32_t threadCount);
+    void newSearch() { generation += generationDelta; };
+    void writeEntry(std::uint64_t hash, std::int16_t depth, ScoreTT score, ScoreTT staticEval, Move move, Bound bound);
     void prefetchTable(std::uint64_t hash);
     bool probeTable(std::uint64_t hash, TTEntry& outEntry);
-    void clear();
+    void clear(std::uint32_t threadCount);
 
     static ScoreTT ScoreToTT(Score score, std::int16_t ply);
     static Score ScoreFromTT(ScoreTT score, std::int16_t ply);
 private:
-    TTEntry* table;
-    std::uint64_t size;
+    void allocateTable(std::uint64_t memorySize);
+    void freeTable();
+
+    std::uint64_t getIndex(std::uint64_t hash) const { return static_cast<std::uint64_t>((static_cast<__uint128_t>(hash) * clusterCount) >> 64); };
+    std::uint8_t relativeAge(const TTEntry& entry) const { return ((generationCycle + generation - entry.generationBound) & generationMask) >> generationBits; };
+
+    TTCluster* table;
+    std::uint64_t clusterCount;
+    std::uint8_t generation;
 };
@@ -1,50 +1,70 @@
 #include "universalchessinterface.hpp"
 
+#include "attacks.hpp"
 #include "bench.hpp"
 #include "evaluate.hpp"
+#include "inputoutput.hpp"
 #include "movelist.hpp"
 #include "movegen.hpp"
+#include "nnue.hpp"
 #include "perft.hpp"
 #include "piece.hpp"
 #include "timeman.hpp"
 #include "see.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <cctype>
 #include <sstream>
 #include <cstring>
 #include <iostream>
-
-Move UniversalChessInterface::parseMove(std::string moveString) {
-    MoveList moveList;
-    generateMoves<MoveType::AllMoves>(moveList, game.getCurrentPosition());
-
-    // parse squares
-    Square sourceSquare {static_cast<uint8_t>((moveString[1] - '1')), static_cast<uint8_t>((moveString[0] - 'a'))};
-    Square targetSquare {static_cast<uint8_t>((moveString[3] - '1')), static_cast<uint8_t>((moveString[2] - 'a'))};
-
-    for (std::uint32_t i = 0; i < moveList.getSize(); i++) {
-        Move move = moveList[i].move;
-
-        if (sourceSquare == move.getFrom() && targetSquare == move.getTo()) {
-            Piece promotionPiece = move.getPromotionPiece();
-
-            if (promotionPiece != static_cast<Piece>(0)) {
-                if ((promotionPiece ==  Piece::WhiteQueen || promotionPiece == Piece::BlackQueen) && (moveString[4] == 'q' || moveString[4] == 'Q')) return move;
-                if ((promotionPiece ==  Piece::WhiteKnight || promotionPiece == Piece::BlackKnight) && (moveString[4] == 'n' || moveString[4] == 'N')) return move;
-                if ((promotionPiece ==  Piece::WhiteRook || promotionPiece == Piece::BlackRook) && (moveString[4] == 'r' || moveString[4] == 'R')) return move;
-                if ((promotionPiece ==  Piece::WhiteBishop || promotionPiece == Piece::BlackBishop) && (moveString[4] == 'b' || moveString[4] == 'B')) return move;
-                continue;
-            }
-            return move;
+#include <thread>
+#include <utility>
+#include <vector>
+
+Move UniversalChessInterface::parseMove(const Position& position, const std::string& moveString) {
+    // the move is built from the squares and the pieces on the board, then checked instead of being searched in a generated list
+    if (moveString.size() < 4 || moveString[0] < 'a' || moveString[0] > 'h' || moveString[1] < '1' || moveString[1] > '8'
+                              || moveString[2] < 'a' || moveString[2] > 'h' || moveString[3] < '1' || moveString[3] > '8') return Move::Invalid();
+
+    const Square from {static_cast<std::uint8_t>(moveString[1] - '1'), static_cast<std::uint8_t>(moveString[0] - 'a')};
+    const Square to {static_cast<std::uint8_t>(moveString[3] - '1'), static_cast<std::uint8_t>(moveString[2] - 'a')};
+    const Piece piece = position.pieceAt(from);
+    if (piece == Piece::None) return Move::Invalid();
+
+    const PieceType pieceType = getPieceType(piece);
+    const bool enPassant = pieceType == PieceType::Pawn && to == position.enPassantSquare;
+    const bool capture = position.pieceAt(to) != Piece::None || enPassant;
+
+    Move move;
+    if (moveString.size() > 4) {
+        PieceType promotionType;
+        switch (std::tolower(moveString[4])) {
+            case 'q': promotionType = PieceType::Queen;  break;
+            case 'r': promotionType = PieceType::Rook;   break;
+            case 'b': promotionType = PieceType::Bishop; break;
+            case 'n': promotionType = PieceType::Knight; break;
+            default:  return Move::Invalid();
         }
+        move = Move(from, to, piece, getPiece(promotionType, getPieceColor(piece)), capture, false, false, false);
+    }
+    else {
+        const bool doublePush = pieceType == PieceType::Pawn && (from.rank() == to.rank() + 2 || to.rank() == from.rank() + 2);
+        const bool castling = pieceType == PieceType::King && (from.file() == to.file() + 2 || to.file() == from.file() + 2);
+        move = Move(from, to, piece, capture, doublePush, enPassant, castling);
     }
 
-    return Move{};
+    const CheckInfo checkInfo = position.computeCheckInfo();
+    return (position.isPseudoLegal(move) && position.isLegal(move, checkInfo)) ? move : Move::Invalid();
 }
 
-void UniversalChessInterface::parsePosition(std::istringstream &ss) {
+void UniversalChessInterface::resetGame() {
     game.reset();
+    positionFen.clear();
+    positionMoves.clear();
+}
 
+void UniversalChessInterface::parsePosition(std::istringstream &ss) {
     std::string token, fen;
     ss >> token;
 
@@ -57,32 +77,49 @@ void UniversalChessInterface::parsePosition(std::istringstream &ss) {
             fen += token + " ";
     }
     else {
-        std::cout << "info string error: invalid command" << std::endl;
+        resetGame();
+        writeLine("info string error: invalid command");
         return;
     }
 
-    Position position;
-    position.loadFromFen(fen);
-    game.recordPosition(position);
-
+    std::vector<std::string> moves;
     if (token == "moves") {
-        Move move;
-        while (ss >> token && (move = parseMove(token)).isValid()) {
-            position.makeMove(move);
-            game.recordPosition(position);
-        }
+        while (ss >> token) moves.push_back(token);
+    }
+
+    // GUIs resend the whole game every ply, when the command extends the current game only the new moves are played
+    const bool extendsGame = game.isValid() && fen == positionFen && moves.size() >= positionMoves.size()
+                          && std::equal(positionMoves.begin(), positionMoves.end(), moves.begin());
+    if (!extendsGame) {
+        resetGame();
+        Position position;
+        position.loadFromFen(fen);
+        game.recordPosition(position);
+        positionFen = fen;
+    }
+
+    Position position = game.getCurrentPosition();
+    for (std::size_t index = positionMoves.size(); index < moves.size(); index++) {
+        const Move move = parseMove(position, moves[index]);
+        if (!move.isValid()) break;
+
+        position.makeMove(move);
+        game.recordPosition(position);
+        positionMoves.push_back(moves[index]);
     }
 }
 
 void UniversalChessInterface::parseGo(std::istringstream &ss) {
     if (!game.isValid()) {
-        std::cout << "info string error: position not set" << std::endl;
+        writeLine("info string error: position not set");
         return;
     }
 
     std::string token;
 
     std::uint32_t depth = maxSearchDepth;
+    std::uint64_t nodes = noNodeLimit;
+    bool ponder = false;
     std::uint32_t movesToGo  = 0;
     TimePoint whiteTime = invalidTimePoint;
     TimePoint blackTime = invalidTimePoint;
@@ -97,12 +134,15 @@ void UniversalChessInterface::parseGo(std::istringstream &ss) {
         else if (token == "binc") ss >> blackIncrement;
         else if (token == "movestogo") ss >> movesToGo;
         else if (token == "depth") ss >> depth;
-        else if (token == "nodes") {}
+        else if (token == "nodes") ss >> nodes;
         else if (token == "movetime") ss >> timePerMove;
         else if (token == "infinite") {}
+        else if (token == "ponder") ponder = true;
     }
 
     searchLimits.depthLimit = depth;
+    searchLimits.nodeLimit = nodes;
+    searchLimits.ponder = ponder;
     searchLimits.searchTimeStart = getTime();
 
     {
@@ -117,7 +157,7 @@ void UniversalChessInterface::parseGo(std::istringstream &ss) {
         computeTimeLimits(timeManagerInitData, searchLimits);
     }
 
-    std::cout << "Search Limits: Depth: " << static_cast<int>(searchLimits.depthLimit) << " Time Limit: " << searchLimits.timeLimit << " Ref Start Time: " << searchLimits.searchTimeStart << std::endl;
+    writeLine("Search Limits: Depth: ", static_cast<int>(searchLimits.depthLimit), " Time Limit: ", searchLimits.timeLimit, " Ref Start Time: ", searchLimits.searchTimeStart);
 
     search.startSearch(game, searchLimits);
 }
@@ -126,55 +166,180 @@ void UniversalChessInterface::parsePerft(std::istringstream &ss) {
     std::string token;
 
     std::uint32_t depth = maxSearchDepth;
+    bool pseudoLegal = false;
     while (ss >> token) {
         if (token == "depth") { ss >> depth; }
+        else if (token == "pseudolegal") { pseudoLegal = true; }
     }
 
-    perft(game.getCurrentPosition(), depth);
+    if (pseudoLegal) perft<false>(game.getCurrentPosition(), depth);
+    else             perft<true>(game.getCurrentPosition(), depth);
 }
 
-void UniversalChessInterface::bench() {
-
-    std::uint64_t totalNodes = 0;
-    TimePoint startTime = getTime();
+void UniversalChessInterface::bench(std::istringstream& ss) {
+    // bench [depth <d>] [nodes <n>], a node limit gives the same node count on any machine
+    std::string token;
+    std::uint32_t depth = 12;
+    std::uint64_t nodes = noNodeLimit;
+    while (ss >> token) {
+        if (token == "depth") ss >> depth;
+        else if (token == "nodes") { ss >> nodes; depth = maxSearchDepth; }
+    }
 
     searchLimits.timeLimit = invalidTimePoint;
-    searchLimits.depthLimit = 12;
+    searchLimits.ponder = false;
+    searchLimits.depthLimit = std::min<std::uint32_t>(depth, maxSearchDepth);
+    searchLimits.nodeLimit = nodes;
+
+    const bool usedNnue = search.isUsingNnue();
+    const bool randomNetwork = getNnueNetworkSource() != NnueNetworkSource::File;
+
+    std::uint64_t totalNodes, nps, nnueTotalNodes, nnueNps;
+    search.setUseNnue(false);
+    benchBackend("classical", totalNodes, nps);
+    benchStopLatency();
+    benchPositionLatency();
+
+    // without a network file the NNUE pass runs on random weights, its node count is meaningless but its speed is not
+    if (randomNetwork) loadRandomNnueNetwork(0x9E3779B97F4A7C15ULL);
+    search.setUseNnue(true);
+    benchBackend(randomNetwork ? "NNUE (random weights)" : "NNUE", nnueTotalNodes, nnueNps);
+
+    if (randomNetwork) unloadNnueNetwork();
+    search.setUseNnue(usedNnue);
+
+    writeLine("===========================\nNNUE/classical nps ratio : ", static_cast<double>(nnueNps) / std::max<std::uint64_t>(nps, 1));
+    writeLine(totalNodes, " nodes ", nps, " nps");
+}
+
+void UniversalChessInterface::benchBackend(const char* backendName, std::uint64_t& totalNodes, std::uint64_t& nps) {
+    totalNodes = 0;
+    std::int64_t totalStartLatency = 0;
+    std::uint64_t totalPawnHashProbes = 0;
+    std::uint64_t totalPawnHashHits = 0;
+    std::uint64_t totalEvaluations = 0;
+    TimePoint startTime = getTime();
 
     for (const auto& benchFen : benchFens) {
-        std::cout << "Current position fen: " << benchFen << std::endl;
+        writeLine("Current position fen: ", benchFen);
 
         Position position;
         position.loadFromFen(benchFen);
 
-        game.reset();
+        resetGame();
         game.recordPosition(position);
 
         searchLimits.searchTimeStart = getTime();
 
-        ThreadData threadData;
-        threadData.searchLimits = searchLimits;
-        threadData.game = &game;
+        search.startSearch(game, searchLimits);
+        search.waitForSearch();
+        totalNodes += search.getNodeCount();
+        totalStartLatency += search.getStartLatency();
+        totalPawnHashProbes += search.getPawnHashProbes();
+        totalPawnHashHits += search.getPawnHashHits();
+        totalEvaluations += search.getEvaluationCount();
+    }
+
+    TimePoint elapsedTime = getTime() - startTime + 1;
+    nps = 1000 * totalNodes / elapsedTime;
+    writeLine("===========================\nEvaluation      : ", backendName, "\nTotal time (ms) : ", elapsedTime, "\nNodes searched  : ", totalNodes, "\nNodes/second    : ", nps, "\nGo latency (us) : ", totalStartLatency / benchFenNb, "\nMove making     : ", moveMakingName, "\nPawn hash hits  : ", 100 * totalPawnHashHits / std::max<std::uint64_t>(totalPawnHashProbes, 1), "%\nEvals per node  : ", static_cast<double>(totalEvaluations) / std::max<std::uint64_t>(totalNodes, 1));
+}
+
+void UniversalChessInterface::benchStopLatency() {
+    // time from a stop command, then from a movetime deadline, to the best move output on searches that are still running
+    constexpr std::uint32_t positionCount = 8;
+    constexpr TimePoint searchTime = 20;
+    std::int64_t totalStopLatency = 0, maxStopLatency = 0, totalTimerLatency = 0, maxTimerLatency = 0;
+
+    for (std::uint32_t index = 0; index < positionCount; index++) {
+        Position position;
+        position.loadFromFen(benchFens[index]);
+
+        resetGame();
+        game.recordPosition(position);
+
+        SearchLimits stopLimits {maxSearchDepth, getTime(), invalidTimePoint};
+        search.startSearch(game, stopLimits);
+        std::this_thread::sleep_for(std::chrono::milliseconds(searchTime));
+        search.stopSearch();
+        totalStopLatency += search.getStopLatency();
+        maxStopLatency = std::max(maxStopLatency, search.getStopLatency());
+
+        const TimePoint startTime = getTime();
+        SearchLimits timerLimits {maxSearchDepth, startTime, startTime + searchTime};
+        search.startSearch(game, timerLimits);
+        search.waitForSearch();
+        totalTimerLatency += search.getStopLatency();
+        maxTimerLatency = std::max(maxTimerLatency, search.getStopLatency());
+    }
+
+    writeLine("===========================\nStop latency (us)  : ", totalStopLatency / positionCount, " avg, ", maxStopLatency, " max\nTimer latency (us) : ", totalTimerLatency / positionCount, " avg, ", maxTimerLatency, " max");
+}
 
-        threadData.searchStack[0].position = position;
-        threadData.searchStack[0].inCheck = position.isInCheck(position.sideToMove);
+void UniversalChessInterface::benchPositionLatency() {
+    // a long game played with a deterministic choice of legal moves, sent again after every ply as a GUI does
+    constexpr std::uint32_t gameLength = 200;
+    std::vector<std::string> commands;
+    std::string command = "startpos moves";
+    Position position;
+    position.loadFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    for (std::uint32_t ply = 0; ply < gameLength; ply++) {
+        LocalMoveList moveList;
+        generateLegalMoves<MoveType::AllMoves>(moveList, position);
+        if (moveList.getSize() == 0) break;
+
+        const Move move = moveList[(ply * 7) % moveList.getSize()];
+        std::ostringstream moveString;
+        moveString << move;
+        command += " " + moveString.str();
+        commands.push_back(command);
+        position.makeMove(move);
+    }
+
+    resetGame();
+    std::int64_t startTime = getTimeMicroseconds();
+    for (const std::string& positionCommand : commands) {
+        std::istringstream ss(positionCommand);
+        parsePosition(ss);
+    }
+    const std::int64_t incrementalTime = getTimeMicroseconds() - startTime;
+
+    startTime = getTimeMicroseconds();
+    for (const std::string& positionCommand : commands) {
+        resetGame();
+        std::istringstream ss(positionCommand);
+        parsePosition(ss);
+    }
+    const std::int64_t replayTime = getTimeMicroseconds() - startTime;
+    resetGame();
+
+    writeLine("===========================\nPosition latency over a ", commands.size(), " ply game (us): ", static_cast<double>(incrementalTime) / commands.size(), " incremental, ", static_cast<double>(replayTime) / commands.size(), " full replay");
+}
 
-        threadData.isMainThread = true;
-        threadData.searchStats = {};
+void UniversalChessInterface::sliderBench() {
+    // rook and bishop lookups from every square with the occupancies of the bench positions
+    std::vector<std::pair<Square, Bitboard>> samples;
+    for (const auto& benchFen : benchFens) {
+        Position position;
+        position.loadFromFen(benchFen);
+        for (std::uint8_t square = 0; square < 64; square++) {
+            samples.emplace_back(Square {square}, position.getOccupied());
+        }
+    }
 
-        threadData.moveHistoryTable = {};
-        threadData.killerMoveTable = {};
-        threadData.counterMoveTable = {};
+    constexpr std::uint32_t iterations = 2000;
+    std::uint64_t checksum = 0;
+    const std::int64_t startTime = getTimeMicroseconds();
 
-        search.setStopSearchFlag(false);
-        search.searchInternal(threadData);
-        totalNodes += threadData.searchStats.quiescenceNodeCounter + threadData.searchStats.negamaxNodeCounter;
+    for (std::uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (const auto& [square, occupied] : samples) {
+            checksum += static_cast<std::uint64_t>(getRookAttacks(square, occupied)) + static_cast<std::uint64_t>(getBishopAttacks(square, occupied));
+        }
     }
 
-    TimePoint elapsedTime = getTime() - startTime;
-    std::uint64_t nps = 1000 * totalNodes / elapsedTime;
-    std::cout << "===========================\nTotal time (ms) : " << elapsedTime << "\nNodes searched  : " << totalNodes << "\nNodes/second    : " << nps << '\n';
-    std::cout << totalNodes << " nodes " << nps << " nps" << std::endl;
+    const std::int64_t elapsedTime = getTimeMicroseconds() - startTime + 1;
+    const std::uint64_t lookups = 2ULL * iterations * samples.size();
+    writeLine("Sliding attacks : ", slidingAttacksName, "\nTable size (KiB): ", getSlidingAttacksTableSize() / 1024, "\nLookups         : ", lookups, "\nTime (us)       : ", elapsedTime, "\nns/lookup       : ", 1000. * elapsedTime / lookups, "\nChecksum        : ", checksum);
 }
 
 void UniversalChessInterface::parseSetOption(std::istringstream &ss) {
@@ -183,45 +348,95 @@ void UniversalChessInterface::parseSetOption(std::istringstream &ss) {
     if (token == "Hash") {
         std::uint64_t memorySize;
         ss >> token >> memorySize;
-        memorySize = memorySize * 1024 * 1024;
+        memorySize = std::clamp<std::uint64_t>(memorySize, 1, maxTTSizeMiB) * 1024 * 1024;
         search.resizeTT(memorySize);
     }
+    else if (token == "Threads") {
+        std::uint32_t threadCount;
+        ss >> token >> threadCount;
+        search.setThreadCount(threadCount);
+    }
+    else if (token == "MultiPV") {
+        std::uint32_t multiPv;
+        ss >> token >> multiPv;
+        search.setMultiPv(multiPv);
+    }
+    else if (token == "EvalFile") {
+        std::string fileName;
+        ss >> token >> std::ws;
+        std::getline(ss, fileName);
+        if (loadNnueNetwork(fileName))                                  search.setUseNnue(search.isUsingNnue());
+        else if (getNnueNetworkSource() != NnueNetworkSource::File)     search.setUseNnue(false);
+    }
+    else if (token == "UseNNUE") {
+        ss >> token >> token;
+        const bool value = (token == "true");
+        if (value && getNnueNetworkSource() != NnueNetworkSource::File) {
+            writeLine("info string error: set EvalFile to a network before enabling UseNNUE");
+        }
+        else {
+            search.setUseNnue(value);
+        }
+    }
 }
 
 void UniversalChessInterface::loop(int argc, char **argv) {
     if (argc > 1 && (strncmp(argv[1], "bench", 5) == 0)) {
-       bench(); return;
+       std::string args;
+       for (int index = 2; index < argc; index++) args += std::string(argv[index]) + " ";
+       std::istringstream ss(args);
+       bench(ss); return;
+    }
+    if (argc > 1 && (strncmp(argv[1], "sliderbench", 11) == 0)) {
+       sliderBench(); return;
+    }
+    if (argc > 1 && (strncmp(argv[1], "sortertest", 10) == 0)) {
+       testMoveSorter(); return;
+    }
+    if (argc > 1 && (strncmp(argv[1], "magics", 6) == 0)) {
+       printMagics(); return;
     }
 
-    std::string cmd;
+    // commands are read on their own thread and search output is written on another one, the controller sleeps between commands
+    CommandReader commandReader;
+    startOutput();
 
     // main loop
     for(;;) {
-
-        if (!std::getline(std::cin, cmd)) continue;
-
-        std::istringstream ss(cmd);
+        std::istringstream ss(commandReader.waitCommand());
         std::string token;
         ss >> std::skipws >> token;
 
         if (token == "quit")            break;
         else if (token == "stop")       search.stopSearch();
+        else if (token == "ponderhit")  search.ponderHit();
         else if (token == "uci")        {
-            std::cout << "id name NONAME\n";
-            std::cout << "id author Thomas Lemercier\n";
-            std::cout << "option name Hash type spin default 8 min 1 max 1000" << std::endl;
-            std::cout << "uciok\n";
+            writeLine("id name NONAME");
+            writeLine("id author Thomas Lemercier");
+            writeLine("option name Hash type spin default ", defaultTTSizeMiB, " min 1 max ", maxTTSizeMiB);
+            writeLine("option name Threads type spin default 1 min 1 max ", maxThreadCount);
+            writeLine("option name Ponder type check default false");
+            writeLine("option name MultiPV type spin default 1 min 1 max ", maxMultiPv);
+            writeLine("option name EvalFile type string default <empty>");
+            writeLine("option name UseNNUE type check default false");
+            writeLine("uciok");
         }
-        else if (token == "isready")    std::cout << "readyok\n" << std::endl;
+        else if (token == "isready")    writeLine("readyok");
         else if (token == "ucinewgame") search.clear();
         else if (token == "position")   parsePosition(ss);
         else if (token == "go")         parseGo(ss);
-        else if (token == "bench")      bench();
+        else if (token == "bench")      bench(ss);
+        else if (token == "sliderbench") sliderBench();
         else if (token == "perft")      parsePerft(ss);
-        else if (token == "eval")       std::cout << "Evaluation value: " << evaluate(game.getCurrentPosition()) << std::endl;
+        else if (token == "eval") {
+            writeLine("Evaluation value: ", evaluate(game.getCurrentPosition()));
+            if (getNnueNetworkSource() == NnueNetworkSource::File) writeLine("NNUE evaluation value: ", evaluateNnue(game.getCurrentPosition()));
+        }
         else if (token == "see")        testSee(game.getCurrentPosition());
+        else if (token == "sortertest") testMoveSorter();
         else if (token == "setoption")  parseSetOption(ss);
     }
 
     search.stopSearch();
+    stopOutput();
 }
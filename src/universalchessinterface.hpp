@@ -4,19 +4,29 @@
 #include "game.hpp"
 #include "search.hpp"
 
+#include <string>
+#include <vector>
+
 class UniversalChessInterface {
 private:
     Game game;
+    std::string positionFen;                    // last position command, to only play the moves added since then
+    std::vector<std::string> positionMoves;
 
     SearchLimits searchLimits;
     Search search;
 
-    Move parseMove(std::string moveString);
+    static Move parseMove(const Position& position, const std::string& moveString);
+    void resetGame();
     void parsePosition(std::istringstream& ss);
     void parseGo(std::istringstream& ss);
     void parsePerft(std::istringstream& ss);
     void parseSetOption(std::istringstream& ss);
-    void bench();
+    void bench(std::istringstream& ss);
+    void benchBackend(const char* backendName, std::uint64_t& totalNodes, std::uint64_t& nps);
+    void benchStopLatency();
+    void benchPositionLatency();
+    void sliderBench();
 public:
     void loop(int argc, char* argv[]);
 
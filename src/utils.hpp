@@ -4,8 +4,10 @@
 #include <cstdint>
 #include <iostream>
 
-#define ASSERT(x) {if (!(x)) { std::cout << "Assertion failed: " << #x << std::endl; } }
-#define WARNING(x) { std::cout << "WARNING: " << x; }
+#include "inputoutput.hpp"
+
+#define ASSERT(x) {if (!(x)) { writeLine("Assertion failed: ", #x); } }
+#define WARNING(x) { std::ostringstream warning; warning << "WARNING: " << x; writeString(warning.str()); }
 
 constexpr std::uint8_t popCount(std::uint64_t x) { return __builtin_popcountll(x); }
 constexpr std::uint8_t getLsbIndex(std::uint64_t x) { return __builtin_ctzll(x); }
@@ -23,6 +25,9 @@ constexpr Score drawValue            = 0;
 
 using TimePoint = std::chrono::milliseconds::rep;
 constexpr TimePoint invalidTimePoint = -1;
-inline TimePoint getTime() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+inline TimePoint getTime() {     // monotonic, milliseconds since the steady_clock epoch
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline std::int64_t getTimeMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
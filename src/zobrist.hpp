@@ -2,14 +2,48 @@
 
 #include "color.hpp"
 #include "piece.hpp"
+#include "rng.hpp"
 #include "square.hpp"
 
 #include <cstdint>
 
-extern std::uint64_t pieceSquareZobristHash[12][64];
-extern std::uint64_t colorZobristHash;
-extern std::uint64_t enPassantFileZobristHash[8];
-extern std::uint64_t castlingRightZobristHash[16];
+struct ZobristKeys {
+    std::uint64_t pieceSquare[12][64];
+    std::uint64_t color;
+    std::uint64_t enPassantFile[8];
+    std::uint64_t castlingRight[16];
+};
 
-void initZobristKeys();
-std::uint64_t getPieceSquareHash(const Color color, const PieceType pieceType, const Square square);
+constexpr ZobristKeys generateZobristKeys() {   // evaluated at compile time, the keys are the same as a runtime fill with this seed
+    PRNG rng { 0x0123456789abcdef };
+    ZobristKeys keys {};
+
+    for (auto& piece : keys.pieceSquare) {
+        for (std::uint64_t& square : piece) {
+            square = rng.next();
+        }
+    }
+
+    keys.color = rng.next();
+
+    for (std::uint64_t& file : keys.enPassantFile) {
+        file = rng.next();
+    }
+
+    for (std::uint64_t& castlingRight : keys.castlingRight) {
+        castlingRight = rng.next();
+    }
+
+    return keys;
+}
+
+inline constexpr ZobristKeys zobristKeys = generateZobristKeys();
+
+inline constexpr const auto& pieceSquareZobristHash = zobristKeys.pieceSquare;
+inline constexpr const std::uint64_t& colorZobristHash = zobristKeys.color;
+inline constexpr const auto& enPassantFileZobristHash = zobristKeys.enPassantFile;
+inline constexpr const auto& castlingRightZobristHash = zobristKeys.castlingRight;
+
+constexpr std::uint64_t getPieceSquareHash(const Color color, const PieceType pieceType, const Square square) {
+    return pieceSquareZobristHash[static_cast<uint8_t>(getPiece(pieceType, color))][square.index()];
+}